@@ -24,6 +24,11 @@
 #include    "snap_builder.h"
 
 
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
 // snaplogger
 //
 #include    <snaplogger/message.h>
@@ -36,6 +41,7 @@
 
 // C++
 //
+#include    <algorithm>
 
 
 
@@ -44,9 +50,60 @@ namespace builder
 
 
 
+void cancel_token::cancel()
+{
+    f_cancelled = true;
+}
+
+
+bool cancel_token::is_cancelled() const
+{
+    return f_cancelled;
+}
+
+
+
+
+
+
+
+
+
 job::job(work_t w)
     : f_work(w)
+    , f_priority(w == work_t::WORK_WATCH_BUILD
+              || w == work_t::WORK_FETCH_BUILD_LOGS
+                    ? priority_t::PRIORITY_BUILD_WATCH
+                    : priority_t::PRIORITY_INTERACTIVE)
+{
+}
+
+
+job::work_t job::get_work() const
+{
+    return f_work;
+}
+
+
+/** \brief Change the priority of this job.
+ *
+ * By default, a job is considered interactive (i.e. the user clicked on
+ * a button) except for the WORK_WATCH_BUILD jobs which are given the
+ * build watch priority. Jobs sent in bulk, such as the loading of all
+ * the projects, should be given the PRIORITY_BULK_LOAD priority so they
+ * do not prevent the other jobs from being processed.
+ *
+ * \param[in] priority  The new priority of this job.
+ */
+void job::set_priority(priority_t priority)
 {
+    f_priority = priority;
+}
+
+
+job::priority_t job::get_priority() const
+{
+    return f_priority;
 }
 
 
@@ -68,6 +125,41 @@ project::pointer_t job::get_project() const
 }
 
 
+void job::set_cancel_token(cancel_token::pointer_t token)
+{
+    f_cancel_token = token;
+}
+
+
+cancel_token::pointer_t job::get_cancel_token() const
+{
+    return f_cancel_token;
+}
+
+
+/** \brief Check whether this job can be cancelled.
+ *
+ * Jobs that were explicitly requested by the user and have side effects
+ * outside of snapbuilder (i.e. sending a build to launchpad or pushing
+ * to git) are not cancelled when the list of projects gets reloaded.
+ *
+ * \return true if the job can be dropped once its token is cancelled.
+ */
+bool job::is_cancellable() const
+{
+    return f_work != work_t::WORK_START_BUILD
+        && f_work != work_t::WORK_GIT_PUSH;
+}
+
+
+bool job::is_cancelled() const
+{
+    return f_cancel_token != nullptr
+        && f_cancel_token->is_cancelled()
+        && is_cancellable();
+}
+
+
 void job::set_next_attempt(int delay)
 {
     snapdev::timespec_ex interval(delay, 0);
@@ -82,6 +174,90 @@ snapdev::timespec_ex const & job::get_next_attempt() const
 }
 
 
+void job::set_sequence(std::uint64_t sequence)
+{
+    f_sequence = sequence;
+}
+
+
+std::uint64_t job::get_sequence() const
+{
+    return f_sequence;
+}
+
+
+/** \brief Check whether this job is a barrier.
+ *
+ * A job which is not attached to a project, such as the
+ * WORK_ADJUST_COLUMNS job, is expected to run once all the jobs sent
+ * before it are done. With a single worker thread that was a given.
+ * With a pool, such a job has to wait for the other workers to be done
+ * with any one of those older jobs.
+ *
+ * \return true if this job has to wait for all the previous jobs.
+ */
+bool job::is_barrier() const
+{
+    return f_project == nullptr;
+}
+
+
+/** \brief Check whether this job does the same work as \p j.
+ *
+ * Many of our jobs are idempotent: loading the same project twice in a
+ * row gives the same result as loading it once. When such a job is sent
+ * while an equivalent job is still waiting to be processed, there is no
+ * need to keep both. The key is the type of work and the project.
+ *
+ * Starting a build is never considered a duplicate and barriers
+ * (jobs without a project) are not either since a new barrier has to
+ * wait on the jobs sent after the older barrier.
+ *
+ * \param[in] j  The job to compare against.
+ *
+ * \return true if \p j can be merged in this job.
+ */
+bool job::is_duplicate_of(job::pointer_t j) const
+{
+    if(f_work != j->f_work
+    || f_project != j->f_project
+    || is_barrier())
+    {
+        return false;
+    }
+
+    switch(f_work)
+    {
+    case work_t::WORK_LOAD_PROJECT:
+    case work_t::WORK_RETRIEVE_PPA_STATUS:
+    case work_t::WORK_WATCH_BUILD:
+    case work_t::WORK_GIT_PUSH:
+    case work_t::WORK_FETCH_BUILD_LOGS:
+        return true;
+
+    default:
+        return false;
+
+    }
+}
+
+
+/** \brief Merge a duplicate in this job.
+ *
+ * The \p duplicate job gets dropped. Any parameter it has that this
+ * job does not yet have is copied.
+ *
+ * \param[in] duplicate  The job being merged in this job.
+ */
+void job::merge(job::pointer_t duplicate)
+{
+    if(f_snap_builder == nullptr)
+    {
+        f_snap_builder = duplicate->f_snap_builder;
+    }
+}
+
+
 /** \brief Process this job.
  *
  * This function is used to process this job.
@@ -98,6 +274,11 @@ snapdev::timespec_ex const & job::get_next_attempt() const
  */
 bool job::process(background_worker * w)
 {
+    if(is_cancelled())
+    {
+        return true;
+    }
+
     switch(f_work)
     {
     case work_t::WORK_UNKNOWN:
@@ -116,19 +297,57 @@ bool job::process(background_worker * w)
         return git_push();
 
     case work_t::WORK_RETRIEVE_PPA_STATUS:
-        return retrieve_ppa_status();
+        if(is_launchpad_paused())
+        {
+            return false;
+        }
+        return retrieve_ppa_status(w);
 
     case work_t::WORK_START_BUILD:
         return start_build(w);
 
     case work_t::WORK_WATCH_BUILD:
-        return watch_build();
+        if(is_launchpad_paused())
+        {
+            return false;
+        }
+        return watch_build(w);
+
+    case work_t::WORK_FETCH_BUILD_LOGS:
+        if(is_launchpad_paused())
+        {
+            return false;
+        }
+        return fetch_build_logs();
 
     }
     snapdev::NOT_REACHED();
 }
 
 
+/** \brief Check whether the launchpad jobs are on pause.
+ *
+ * When launchpad fails repeatedly, all the jobs which only talk to
+ * launchpad wait until it is available again instead of each sending
+ * its own requests. The jobs get spread over a few seconds after the
+ * pause so only one of them ends up sending the probe request.
+ *
+ * \return true if the job was postponed.
+ */
+bool job::is_launchpad_paused()
+{
+    remote_health::pointer_t health(f_snap_builder->get_remote_health());
+    int const pause(health->get_pause());
+    if(pause == 0)
+    {
+        return false;
+    }
+
+    set_next_attempt(pause + health->get_retry_delay(0));
+    return true;
+}
+
+
 bool job::load_project(background_worker * w)
 {
     SNAP_LOG_DEBUG
@@ -138,15 +357,14 @@ bool job::load_project(background_worker * w)
         << SNAP_LOG_SEND;
 
     f_project->load_project();
-    f_project->project_changed();
+    project_changed();
+    check_build_logs(w);
 
     if(f_project->is_building())
     {
         // watch this build
         //
-        job::pointer_t j(std::make_shared<job>(job::work_t::WORK_WATCH_BUILD));
-        j->set_project(f_project);
-        w->send_job(j);
+        send_follow_up_job(w, job::work_t::WORK_WATCH_BUILD);
     }
 
     return true;
@@ -169,24 +387,41 @@ bool job::git_push()
 }
 
 
-bool job::retrieve_ppa_status()
+bool job::retrieve_ppa_status(background_worker * w)
 {
     // try to get the remote data, if it fails, try again up to 5 times
+    // with an exponential backoff; failures while launchpad is known to
+    // be down do not count since the request was not even sent
     //
-    bool success(f_project->retrieve_ppa_status());
-    if(!success
-    && f_retries < 5)
+    http_client::result_t const result(f_project->retrieve_ppa_status());
+    if(result == http_client::result_t::RESULT_FAILED)
     {
-        ++f_retries;
-        set_next_attempt(60 * 3 * f_retries);
-        return false;
+        remote_health::pointer_t health(f_snap_builder->get_remote_health());
+        if(health->get_state() != remote_health::state_t::STATE_CLOSED)
+        {
+            set_next_attempt(health->get_pause() + health->get_retry_delay(0));
+            return false;
+        }
+        if(f_retries < 5)
+        {
+            ++f_retries;
+            set_next_attempt(health->get_retry_delay(f_retries));
+            return false;
+        }
     }
 
     // we just updated the PPA status file so we force a reload of the
-    // remote data to see the results
+    // remote data to see the results, unless it did not change
     //
+    if(is_cancelled()
+    || result == http_client::result_t::RESULT_NOT_MODIFIED)
+    {
+        return true;
+    }
+
     f_project->load_remote_data(true);
-    f_project->project_changed();
+    project_changed();
+    check_build_logs(w);
 
     return true;
 }
@@ -196,21 +431,20 @@ bool job::start_build(background_worker * w)
 {
     f_project->start_build();
 
-    job::pointer_t j(std::make_shared<job>(job::work_t::WORK_WATCH_BUILD));
-    j->set_project(f_project);
-    w->send_job(j);
+    send_follow_up_job(w, job::work_t::WORK_WATCH_BUILD);
 
     return true;
 }
 
 
-bool job::watch_build()
+bool job::watch_build(background_worker * w)
 {
     if(!f_project->is_valid())
     {
         SNAP_LOG_ERROR
             << "watch_build() called with an invalid project."
             << SNAP_LOG_SEND;
+        f_snap_builder->get_poll_scheduler()->forget(f_project->get_name());
         return true;
     }
 
@@ -219,104 +453,607 @@ bool job::watch_build()
         SNAP_LOG_RECOVERABLE_ERROR
             << "watch_build() called with a project that is not being built."
             << SNAP_LOG_SEND;
+        f_snap_builder->get_poll_scheduler()->forget(f_project->get_name());
         return true;
     }
 
-    if(!f_project->retrieve_ppa_status())
+    // with the sweep, one request returns the records of all the
+    // projects being built; otherwise each project sends its own request
+    //
+    build_sweep::pointer_t sweep(f_snap_builder->get_build_sweep());
+    http_client::result_t const result(sweep != nullptr
+                    ? f_project->sweep_remote_data(sweep)
+                    : f_project->retrieve_ppa_status());
+    if(result == http_client::result_t::RESULT_FAILED)
     {
         // we need to continue to work on this one
         //
-        // retry in 60 seconds
-        //
-        // TODO: look into testing one project per minute, with this
-        //       implementation (like the older one) all the building
-        //       projects are being checked in a row
-        //
-        // packaging is really slow, only check once every 5 min.
-        //
-        set_next_attempt(f_project->is_packaging() ? 60 * 5 : 60);
+        set_next_attempt(next_poll());
         return false;
     }
 
-    f_project->load_remote_data(false);
-    f_project->project_changed();
+    if(is_cancelled())
+    {
+        return true;
+    }
+
+    // while compiling, the JSON is all we look at so if it did not change
+    // there is nothing to reload; while packaging, we instead check the
+    // .deb files so we have to go on
+    //
+    if(result == http_client::result_t::RESULT_NOT_MODIFIED
+    && !f_project->is_packaging())
+    {
+        set_next_attempt(next_poll());
+        return false;
+    }
+
+    if(sweep == nullptr)
+    {
+        f_project->load_remote_data(false);
+    }
+    project_changed();
 
     if(f_project->is_building())
     {
         // as above, while building, we need to repeat the check over and
         // over until everything is done one way or the other
         //
-        set_next_attempt(f_project->is_packaging() ? 60 * 5 : 60);
+        set_next_attempt(next_poll());
         return false;
     }
 
     // success
     //
+    f_snap_builder->get_poll_scheduler()->forget(f_project->get_name());
+    check_build_logs(w);
     return true;
 }
 
 
+/** \brief Extract the errors of the failed builds.
+ *
+ * The build logs are downloaded and scanned for errors. The errors
+ * are then shown in the tooltip of the build state.
+ */
+bool job::fetch_build_logs()
+{
+    f_project->fetch_build_logs();
+    project_changed();
 
+    return true;
+}
 
 
+/** \brief Fetch the build logs if the failed builds changed.
+ *
+ * \param[in] w  The pool of workers where the job gets sent.
+ */
+void job::check_build_logs(background_worker * w)
+{
+    if(!is_cancelled()
+    && f_project->needs_build_logs())
+    {
+        send_follow_up_job(w, job::work_t::WORK_FETCH_BUILD_LOGS);
+    }
+}
 
 
+/** \brief Get the delay until the next check of a build.
+ *
+ * The poll scheduler decides when to check the build again depending
+ * on when we expect the build to be done.
+ *
+ * \return The number of seconds to wait.
+ */
+int job::next_poll() const
+{
+    return f_snap_builder->get_poll_scheduler()->next_poll(
+              f_project->get_name()
+            , f_project->get_expected_completion());
+}
 
 
+/** \brief Tell the interface that the project changed.
+ *
+ * If the job was cancelled while it was running, the project object is
+ * not shown in the table anymore so the signal is not emitted.
+ */
+void job::project_changed()
+{
+    if(is_cancelled())
+    {
+        SNAP_LOG_DEBUG
+            << "worker: job for \""
+            << f_project->get_name()
+            << "\" was cancelled, ignore the changes."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    f_project->project_changed();
+}
+
+
+/** \brief Send a job for the same project.
+ *
+ * Some jobs need another job to be run once they are done. For example,
+ * once we started a build, we want to watch that build. The new job
+ * is part of the same generation as this job.
+ *
+ * \param[in] w  The pool of workers where the job gets sent.
+ * \param[in] work  The type of work of the new job.
+ */
+void job::send_follow_up_job(background_worker * w, work_t work)
+{
+    job::pointer_t j(std::make_shared<job>(work));
+    j->set_project(f_project);
+    j->set_snap_builder(f_snap_builder);
+    j->set_cancel_token(f_cancel_token);
+    if(j->is_cancelled())
+    {
+        return;
+    }
+    w->send_job(j);
+}
+
 
 
 
 
 
-background_worker::background_worker()
-    : runner("worker")
+
+
+
+
+
+
+
+
+bool job_timer_queue::empty() const
 {
+    return f_heap.empty();
 }
 
 
-void background_worker::send_job(job::pointer_t j)
+std::size_t job_timer_queue::size() const
 {
-    f_job_fifo.push_back(j);
+    return f_heap.size();
 }
 
 
-void background_worker::run()
+void job_timer_queue::push(job::pointer_t j)
+{
+    f_heap.push_back(j);
+    std::push_heap(f_heap.begin(), f_heap.end(), later);
+}
+
+
+/** \brief Get the time when the earliest job has to be processed.
+ *
+ * \warning
+ * The queue must not be empty when calling this function.
+ *
+ * \return The next attempt time of the earliest job.
+ */
+snapdev::timespec_ex const & job_timer_queue::get_next_attempt() const
+{
+    return f_heap.front()->get_next_attempt();
+}
+
+
+/** \brief Search the queue for a job doing the same work as \p j.
+ *
+ * \param[in] j  The job to search a duplicate of.
+ *
+ * \return The duplicate or nullptr if there is no such job in the queue.
+ */
+job::pointer_t job_timer_queue::find_duplicate(job::pointer_t j) const
+{
+    auto const it(std::find_if(
+              f_heap.begin()
+            , f_heap.end()
+            , [j](job::pointer_t d)
+              {
+                  return d->is_duplicate_of(j);
+              }));
+    if(it == f_heap.end())
+    {
+        return job::pointer_t();
+    }
+    return *it;
+}
+
+
+/** \brief Remove all the cancelled jobs.
+ *
+ * \return The number of jobs that were removed.
+ */
+std::size_t job_timer_queue::remove_cancelled()
+{
+    std::size_t const size(f_heap.size());
+    f_heap.erase(
+          std::remove_if(
+                  f_heap.begin()
+                , f_heap.end()
+                , [](job::pointer_t j)
+                  {
+                      return j->is_cancelled();
+                  })
+        , f_heap.end());
+    std::make_heap(f_heap.begin(), f_heap.end(), later);
+    return size - f_heap.size();
+}
+
+
+/** \brief Remove all the jobs that are due.
+ *
+ * This function moves all the jobs with a next attempt time smaller or
+ * equal to \p now to the \p due list, earliest first. This way, one
+ * wake up processes all the jobs that timed out.
+ *
+ * \param[in] now  The current time.
+ * \param[in,out] due  The list where the due jobs get appended.
+ */
+void job_timer_queue::pop_due(
+      snapdev::timespec_ex const & now
+    , job::list_t & due)
+{
+    while(!f_heap.empty()
+       && f_heap.front()->get_next_attempt() <= now)
+    {
+        std::pop_heap(f_heap.begin(), f_heap.end(), later);
+        due.push_back(f_heap.back());
+        f_heap.pop_back();
+    }
+}
+
+
+/** \brief Compare two jobs.
+ *
+ * The standard heap functions create a max-heap. To get the earliest job
+ * at the front, the comparison is inverted. Jobs with the same time are
+ * kept in the order they were sent.
+ *
+ * \param[in] a  The left hand side job.
+ * \param[in] b  The right hand side job.
+ *
+ * \return true if \p a has to be processed after \p b.
+ */
+bool job_timer_queue::later(job::pointer_t a, job::pointer_t b)
+{
+    if(a->get_next_attempt() == b->get_next_attempt())
+    {
+        return a->get_sequence() > b->get_sequence();
+    }
+    return b->get_next_attempt() < a->get_next_attempt();
+}
+
+
+
+
+
+
+
+
+
+worker::worker(background_worker * pool, std::size_t position)
+    : runner("worker #" + std::to_string(position))
+    , f_pool(pool)
+    , f_position(position)
+{
+}
+
+
+void worker::run()
 {
     while(continue_running())
     {
-        std::int64_t const usecs(get_timeout());
-        job::pointer_t j;
-        if(f_job_fifo.pop_front(j, usecs))
+        job::pointer_t j(f_pool->next_job());
+        if(j == nullptr)
         {
-            if(!j->process(this))
-            {
-                f_extra_work.push_back(j);
-            }
+            // quitting, ignore anything else
+            //
+            break;
         }
-        else
+
+        f_pool->job_done(j, j->process(f_pool));
+    }
+
+    SNAP_LOG_DEBUG
+        << "worker #"
+        << f_position
+        << " is done."
+        << SNAP_LOG_SEND;
+}
+
+
+
+
+
+
+
+
+
+/** \brief Initialize the pool of workers.
+ *
+ * The background worker manages a pool of \p pool_size threads. All the
+ * threads share the same list of jobs. A job attached to a project is
+ * never run while another job for the same project is running (i.e. the
+ * project functions are not expected to be re-entrant) but jobs for
+ * different projects run in parallel.
+ *
+ * The threads do not start until you call the start() function.
+ *
+ * \param[in] pool_size  The number of threads to create in the pool.
+ */
+background_worker::background_worker(std::size_t pool_size)
+    : f_pool_size(std::max(pool_size, static_cast<std::size_t>(1)))
+{
+}
+
+
+std::size_t background_worker::get_pool_size() const
+{
+    return f_pool_size;
+}
+
+
+void background_worker::start()
+{
+    for(std::size_t idx(0); idx < f_pool_size; ++idx)
+    {
+        worker::pointer_t w(std::make_shared<worker>(this, idx + 1));
+        f_workers.push_back(w);
+
+        cppthread::thread::pointer_t t(std::make_shared<cppthread::thread>(
+                  "worker_thread_" + std::to_string(idx + 1)
+                , w));
+        f_threads.push_back(t);
+        t->start();
+    }
+}
+
+
+void background_worker::stop()
+{
+    {
+        cppthread::guard lock(f_mutex);
+        f_done = true;
+        f_mutex.broadcast();
+    }
+
+    for(auto & t : f_threads)
+    {
+        t->stop();
+    }
+}
+
+
+/** \brief Check whether the caller is one of our worker threads.
+ *
+ * The project functions which block (i.e. run a process or download a
+ * file) must be called from one of the worker threads. This function
+ * is used to verify that this is the case.
+ *
+ * \return true if the caller is running in one of the workers.
+ */
+bool background_worker::is_worker_thread() const
+{
+    pid_t const tid(cppthread::gettid());
+    return std::any_of(
+              f_threads.begin()
+            , f_threads.end()
+            , [tid](cppthread::thread::pointer_t t)
+              {
+                  return t->get_thread_tid() == tid;
+              });
+}
+
+
+background_worker::statistics_t background_worker::get_statistics() const
+{
+    cppthread::guard lock(f_mutex);
+
+    statistics_t stats;
+    for(auto const & fifo : f_job_fifos)
+    {
+        stats.f_queued += fifo.size();
+    }
+    stats.f_running = f_running.size();
+    stats.f_delayed = f_extra_work.size();
+    stats.f_merged = f_merged;
+    stats.f_cancelled = f_cancelled;
+    return stats;
+}
+
+
+/** \brief Add a job to the list of jobs to process.
+ *
+ * If the job is a duplicate of a job still waiting to be processed, the
+ * new job is merged in the existing one instead of being added. Jobs that
+ * are currently running are not considered since the state may have
+ * changed since they started.
+ *
+ * A watch job is also merged with a delayed watch job of the same project
+ * since that existing job will check the build again anyway.
+ *
+ * \param[in] j  The job to add.
+ */
+void background_worker::send_job(job::pointer_t j)
+{
+    cppthread::guard lock(f_mutex);
+
+    job::pointer_t duplicate;
+    for(auto & fifo : f_job_fifos)
+    {
+        auto const it(std::find_if(
+                  fifo.begin()
+                , fifo.end()
+                , [j](job::pointer_t d)
+                  {
+                      return d->is_duplicate_of(j);
+                  }));
+        if(it != fifo.end())
         {
-            if(f_job_fifo.is_done())
-            {
-                // quitting, ignore anything else
-                //
-                break;
-            }
+            duplicate = *it;
 
-            // the pop_front() function timed out, check the next piece
-            // of work to process
+            // the user clicking on a button has to be processed now
+            // even if the same job was already sent by a bulk load
             //
-            if(f_extra_work.empty())
+            if(j->get_priority() < duplicate->get_priority())
             {
-                throw std::runtime_error("somehow f_work_fifo returned false when it is not done and there isn't extra work.");
+                fifo.erase(it);
+                duplicate->set_priority(j->get_priority());
+                get_fifo(duplicate->get_priority()).push_back(duplicate);
             }
-            if(f_extra_work.front()->process(this))
+            break;
+        }
+    }
+    if(duplicate == nullptr
+    && j->get_work() == job::work_t::WORK_WATCH_BUILD)
+    {
+        duplicate = f_extra_work.find_duplicate(j);
+    }
+    if(duplicate != nullptr)
+    {
+        duplicate->merge(j);
+        ++f_merged;
+
+        SNAP_LOG_DEBUG
+            << "worker: merged duplicate job for project \""
+            << j->get_project()->get_name()
+            << "\"."
+            << SNAP_LOG_SEND;
+
+        f_mutex.broadcast();
+        return;
+    }
+
+    queue_job(j);
+
+    f_mutex.broadcast();
+}
+
+
+/** \brief Cancel all the jobs using the specified token.
+ *
+ * This function marks the token as cancelled and removes all the queued
+ * and delayed jobs that use it. Jobs that are currently running check
+ * the token and stop as soon as possible.
+ *
+ * \param[in] token  The token of the jobs to cancel.
+ */
+void background_worker::cancel(cancel_token::pointer_t token)
+{
+    cppthread::guard lock(f_mutex);
+
+    token->cancel();
+
+    std::size_t count(f_extra_work.remove_cancelled());
+    for(auto & fifo : f_job_fifos)
+    {
+        std::size_t const size(fifo.size());
+        fifo.remove_if([](job::pointer_t j)
             {
-                // done with that one
-                //
-                f_extra_work.erase(f_extra_work.begin());
+                return j->is_cancelled();
+            });
+        count += size - fifo.size();
+    }
+    f_cancelled += count;
+
+    SNAP_LOG_DEBUG
+        << "worker: cancelled "
+        << count
+        << " job(s)."
+        << SNAP_LOG_SEND;
+
+    f_mutex.broadcast();
+}
+
+
+/** \brief Wait for the next job to process.
+ *
+ * This function is called by the worker threads. It blocks until a job
+ * can be processed. A job can be processed if its project is not already
+ * being worked on by another thread. A job without a project acts as a
+ * barrier: it waits for all the jobs sent before it to be done.
+ *
+ * Jobs which returned false from their process() function are kept in
+ * the f_extra_work list until their next attempt time is reached.
+ *
+ * \return The next job to process or nullptr if the pool is being stopped.
+ */
+job::pointer_t background_worker::next_job()
+{
+    cppthread::guard lock(f_mutex);
+
+    for(;;)
+    {
+        if(f_done)
+        {
+            return job::pointer_t();
+        }
+
+        wake_up_delayed_jobs();
+
+        job::pointer_t j(find_ready_job());
+        if(j != nullptr)
+        {
+            f_running.push_back(j);
+            if(!j->is_barrier())
+            {
+                f_busy_projects.insert(j->get_project()->get_name());
             }
+            return j;
+        }
+
+        // nothing we can do right now, wait for a job to be sent or done
+        // or for the next delayed job to be ready
+        //
+        std::int64_t const usecs(get_timeout());
+        if(usecs < 0)
+        {
+            f_mutex.wait();
+        }
+        else
+        {
+            f_mutex.timed_wait(usecs);
         }
     }
+    snapdev::NOT_REACHED();
+}
+
+
+/** \brief Mark a job as done.
+ *
+ * Once a worker is done processing a job, it calls this function. This
+ * frees the project so other jobs for that same project can be processed.
+ *
+ * If \p done is false, the job has more work to do later. It gets added
+ * to the list of delayed jobs and will be processed again once its next
+ * attempt time is reached.
+ *
+ * \param[in] j  The job that was just processed.
+ * \param[in] done  Whether the job is done.
+ */
+void background_worker::job_done(job::pointer_t j, bool done)
+{
+    cppthread::guard lock(f_mutex);
+
+    f_running.remove(j);
+    if(!j->is_barrier())
+    {
+        f_busy_projects.erase(j->get_project()->get_name());
+    }
+
+    if(!done
+    && !j->is_cancelled())
+    {
+        f_extra_work.push(j);
+    }
+
+    f_mutex.broadcast();
 }
 
 
@@ -325,23 +1062,154 @@ std::int64_t background_worker::get_timeout()
     std::int64_t usecs(-1);
     if(!f_extra_work.empty())
     {
-        f_extra_work.sort([](job::pointer_t a, job::pointer_t b)
-            {
-                return a->get_next_attempt() < b->get_next_attempt();
-            });
-        snapdev::timespec_ex earliest(f_extra_work.front()->get_next_attempt());
+        snapdev::timespec_ex earliest(f_extra_work.get_next_attempt());
         snapdev::timespec_ex now(snapdev::now());
         earliest -= now;
-        usecs = std::max(earliest.to_usec(), 0L);
+        usecs = std::max(earliest.to_usec(), 1L);
     }
 
     return usecs;
 }
 
 
-void background_worker::stop()
+void background_worker::wake_up_delayed_jobs()
+{
+    job::list_t due;
+    f_extra_work.pop_due(snapdev::now(), due);
+    for(auto & j : due)
+    {
+        // it's as if it was sent again
+        //
+        queue_job(j);
+    }
+}
+
+
+void background_worker::queue_job(job::pointer_t j)
 {
-    f_job_fifo.done(false);
+    ++f_next_sequence;
+    j->set_sequence(f_next_sequence);
+    get_fifo(j->get_priority()).push_back(j);
+}
+
+
+job::list_t & background_worker::get_fifo(job::priority_t priority)
+{
+    return f_job_fifos[static_cast<std::size_t>(priority)];
+}
+
+
+/** \brief Search for the next job to process.
+ *
+ * The jobs are searched by priority. All the interactive jobs are checked
+ * first, then the build watch jobs, the local refresh jobs, and finally
+ * the bulk load jobs. Since a bulk load is composed of one job per
+ * project, the workers go back to the higher priority jobs between each
+ * project.
+ *
+ * \return The job to process or nullptr if no job can be processed now.
+ */
+job::pointer_t background_worker::find_ready_job()
+{
+    for(auto & fifo : f_job_fifos)
+    {
+        if(&fifo == &get_fifo(job::priority_t::PRIORITY_BULK_LOAD)
+        && is_bulk_load_saturated())
+        {
+            break;
+        }
+
+        for(auto it(fifo.begin()); it != fifo.end(); ++it)
+        {
+            if((*it)->is_barrier())
+            {
+                if(it != fifo.begin()
+                || is_barrier_blocked(*it))
+                {
+                    // jobs sent after a barrier have to wait for the barrier
+                    //
+                    break;
+                }
+            }
+            else if(is_busy(*it))
+            {
+                continue;
+            }
+
+            job::pointer_t j(*it);
+            fifo.erase(it);
+            return j;
+        }
+    }
+
+    return job::pointer_t();
+}
+
+
+/** \brief Check whether the bulk load jobs use enough workers.
+ *
+ * When the pool has more than one worker, one of them is kept available
+ * for the other jobs. This way a click from the user does not have to
+ * wait for a bulk load job to be done before it gets processed.
+ *
+ * \return true if no more bulk load jobs should be started.
+ */
+bool background_worker::is_bulk_load_saturated() const
+{
+    if(f_pool_size <= 1)
+    {
+        return false;
+    }
+
+    std::size_t const bulk_jobs(std::count_if(
+              f_running.begin()
+            , f_running.end()
+            , [](job::pointer_t r)
+              {
+                  return r->get_priority() == job::priority_t::PRIORITY_BULK_LOAD;
+              }));
+    return bulk_jobs >= f_pool_size - 1;
+}
+
+
+bool background_worker::is_busy(job::pointer_t j) const
+{
+    return f_busy_projects.find(j->get_project()->get_name()) != f_busy_projects.end();
+}
+
+
+/** \brief Check whether a barrier has to wait for older jobs.
+ *
+ * A barrier runs only once all the jobs sent before it are done. These
+ * may be running or still queued in any of the FIFOs, for example a job
+ * skipped by find_ready_job() because its project is busy.
+ *
+ * \param[in] j  The barrier job.
+ *
+ * \return true if a job older than \p j is still running or queued.
+ */
+bool background_worker::is_barrier_blocked(job::pointer_t j) const
+{
+    std::uint64_t const sequence(j->get_sequence());
+    auto const older([sequence](job::pointer_t r)
+        {
+            return r->get_sequence() < sequence;
+        });
+
+    if(std::any_of(f_running.begin(), f_running.end(), older))
+    {
+        return true;
+    }
+
+    for(auto const & fifo : f_job_fifos)
+    {
+        if(std::any_of(fifo.begin(), fifo.end(), older))
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 
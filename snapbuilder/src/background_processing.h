@@ -25,8 +25,18 @@
 
 // cppthread
 //
-#include    <cppthread/fifo.h>
+#include    <cppthread/mutex.h>
 #include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <array>
+#include    <atomic>
+#include    <list>
+#include    <set>
+#include    <vector>
 
 
 
@@ -39,11 +49,31 @@ class snap_builder;
 class background_worker;
 
 
+/** \brief Token used to cancel a set of jobs.
+ *
+ * All the jobs sent for one generation of the list of projects share
+ * the same token. When the list gets reloaded, the token is cancelled
+ * and the jobs still referencing the old project objects get dropped.
+ */
+class cancel_token
+{
+public:
+    typedef std::shared_ptr<cancel_token>   pointer_t;
+
+    void                            cancel();
+    bool                            is_cancelled() const;
+
+private:
+    std::atomic<bool>               f_cancelled = std::atomic<bool>(false);
+};
+
+
 class job
 {
 public:
     typedef std::shared_ptr<job>    pointer_t;
     typedef std::list<pointer_t>    list_t;
+    typedef std::vector<pointer_t>  vector_t;
 
     enum class work_t
     {
@@ -55,66 +85,182 @@ public:
         WORK_START_BUILD,
         WORK_WATCH_BUILD,
         WORK_GIT_PUSH,
+        WORK_FETCH_BUILD_LOGS,
+    };
+
+    // the order matters, lower values are processed first
+    //
+    enum class priority_t
+    {
+        PRIORITY_INTERACTIVE,       // the user clicked on something
+        PRIORITY_BUILD_WATCH,       // checking on a build on launchpad
+        PRIORITY_LOCAL_REFRESH,     // a project changed locally (git, changelog)
+        PRIORITY_BULK_LOAD,         // (re)loading the entire list of projects
+
+        PRIORITY_COUNT
     };
 
                                     job(work_t w);
                                     job(job const &) = delete;
     job &                           operator = (job const &) = delete;
 
-    //work_t                          get_work() const;
+    work_t                          get_work() const;
+    void                            set_priority(priority_t priority);
+    priority_t                      get_priority() const;
 
     void                            set_snap_builder(snap_builder * sb);
 
     void                            set_project(project::pointer_t p);
     project::pointer_t              get_project() const;
 
+    void                            set_cancel_token(cancel_token::pointer_t token);
+    cancel_token::pointer_t         get_cancel_token() const;
+    bool                            is_cancellable() const;
+    bool                            is_cancelled() const;
+
     void                            set_next_attempt(int seconds_from_now);
     snapdev::timespec_ex const &    get_next_attempt() const;
 
+    void                            set_sequence(std::uint64_t sequence);
+    std::uint64_t                   get_sequence() const;
+    bool                            is_barrier() const;
+    bool                            is_duplicate_of(job::pointer_t j) const;
+    void                            merge(job::pointer_t duplicate);
+
     bool                            process(background_worker * w);
 
 private:
+    bool                            is_launchpad_paused();
     bool                            load_project(background_worker * w);
     bool                            adjust_columns();
     bool                            git_push();
-    bool                            retrieve_ppa_status();
+    bool                            retrieve_ppa_status(background_worker * w);
     bool                            start_build(background_worker * w);
-    bool                            watch_build();
+    bool                            watch_build(background_worker * w);
+    bool                            fetch_build_logs();
+    void                            check_build_logs(background_worker * w);
+    int                             next_poll() const;
+    void                            project_changed();
+    void                            send_follow_up_job(background_worker * w, work_t work);
 
     work_t                          f_work = work_t::WORK_UNKNOWN;
+    priority_t                      f_priority = priority_t::PRIORITY_INTERACTIVE;
     project::pointer_t              f_project = project::pointer_t();
+    cancel_token::pointer_t         f_cancel_token = cancel_token::pointer_t();
     snap_builder *                  f_snap_builder = nullptr;
     snapdev::timespec_ex            f_next_attempt = snapdev::timespec_ex();
+    std::uint64_t                   f_sequence = 0;
     int                             f_retries = 0;
 };
 
 
-class background_worker
+/** \brief Queue of delayed jobs.
+ *
+ * The jobs which need to be processed again later are saved in a binary
+ * heap sorted by their next attempt time. Adding a job is O(log n) and
+ * finding the earliest job is O(1).
+ */
+class job_timer_queue
+{
+public:
+    bool                            empty() const;
+    std::size_t                     size() const;
+    void                            push(job::pointer_t j);
+    snapdev::timespec_ex const &    get_next_attempt() const;
+    job::pointer_t                  find_duplicate(job::pointer_t j) const;
+    std::size_t                     remove_cancelled();
+    void                            pop_due(
+                                          snapdev::timespec_ex const & now
+                                        , job::list_t & due);
+
+private:
+    static bool                     later(job::pointer_t a, job::pointer_t b);
+
+    job::vector_t                   f_heap = job::vector_t();
+};
+
+
+class worker
     : public cppthread::runner
 {
+public:
+    typedef std::shared_ptr<worker>     pointer_t;
+    typedef std::vector<pointer_t>      vector_t;
+
+                                worker(background_worker * pool, std::size_t position);
+                                worker(worker const &) = delete;
+    worker &                    operator = (worker const &) = delete;
+
+    // cppthread::runner implementation
+    //
+    virtual void                run() override;
+
+private:
+    background_worker *         f_pool = nullptr;
+    std::size_t                 f_position = 0;
+};
+
+
+class background_worker
+{
 public:
     typedef std::shared_ptr<background_worker>
                                 pointer_t;
 
-                                background_worker();
+    struct statistics_t
+    {
+        std::size_t             f_queued = 0;
+        std::size_t             f_running = 0;
+        std::size_t             f_delayed = 0;
+        std::size_t             f_merged = 0;
+        std::size_t             f_cancelled = 0;
+    };
+
+                                background_worker(std::size_t pool_size);
                                 background_worker(background_worker const &) = delete;
     background_worker &         operator = (background_worker const &) = delete;
 
+    std::size_t                 get_pool_size() const;
+    void                        start();
+    void                        stop();
+    bool                        is_worker_thread() const;
+    statistics_t                get_statistics() const;
+
     void                        send_job(job::pointer_t j);
+    void                        cancel(cancel_token::pointer_t token);
 
-    // cppthread::runner implementation
+    // used by the worker threads
     //
-    virtual void                run();
-
-    void                        stop();
+    job::pointer_t              next_job();
+    void                        job_done(job::pointer_t j, bool done);
 
 private:
-    typedef cppthread::fifo<job::pointer_t>    job_fifo_t;
+    typedef std::vector<cppthread::thread::pointer_t>
+                                thread_vector_t;
+    typedef std::array<job::list_t, static_cast<std::size_t>(job::priority_t::PRIORITY_COUNT)>
+                                job_fifos_t;
 
     std::int64_t                get_timeout();
-
-    job_fifo_t                  f_job_fifo = job_fifo_t();
-    job::list_t                 f_extra_work = job::list_t();
+    void                        wake_up_delayed_jobs();
+    void                        queue_job(job::pointer_t j);
+    job::list_t &               get_fifo(job::priority_t priority);
+    job::pointer_t              find_ready_job();
+    bool                        is_bulk_load_saturated() const;
+    bool                        is_busy(job::pointer_t j) const;
+    bool                        is_barrier_blocked(job::pointer_t j) const;
+
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    std::size_t                 f_pool_size = 1;
+    worker::vector_t            f_workers = worker::vector_t();
+    thread_vector_t             f_threads = thread_vector_t();
+    job_fifos_t                 f_job_fifos = job_fifos_t();
+    job_timer_queue             f_extra_work = job_timer_queue();
+    job::list_t                 f_running = job::list_t();
+    std::set<std::string>       f_busy_projects = std::set<std::string>();
+    std::uint64_t               f_next_sequence = 0;
+    std::size_t                 f_merged = 0;
+    std::size_t                 f_cancelled = 0;
+    bool                        f_done = false;
 };
 
 
@@ -0,0 +1,330 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "build_log.h"
+
+#include    "pattern_matcher.h"
+#include    "snap_builder.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/not_used.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <deque>
+#include    <fstream>
+
+
+// C
+//
+#include    <unistd.h>
+#include    <zlib.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// the number of error lines we keep for each build
+//
+constexpr std::size_t const     g_excerpt_lines = 20;
+
+// longer lines get truncated
+//
+constexpr std::size_t const     g_max_line_length = 300;
+
+// the lines including one of these strings are considered relevant
+//
+constexpr char const * const    g_error_patterns[] =
+{
+    "error:",
+    "Error:",
+    "ERROR:",
+    "fatal error",
+    "internal compiler error",
+    "undefined reference to",
+    "multiple definition of",
+    "undefined symbol",
+    "cannot find -l",
+    "No such file or directory",
+    "collect2:",
+    "ld returned",
+    "] Error ",
+    ": *** ",
+    "CMake Error",
+    "Errors while running CTest",
+    "tests failed out of",
+    "Segmentation fault",
+    "Killed signal terminated",
+    "dh_auto_configure: error",
+    "dh_auto_build: error",
+    "dh_auto_test: error",
+    "dpkg-buildpackage: error",
+    "E: Build killed",
+    "FAILED:",
+};
+
+
+pattern_matcher const & get_error_matcher()
+{
+    static pattern_matcher const matcher([]()
+        {
+            pattern_matcher m;
+            for(auto const p : g_error_patterns)
+            {
+                m.add_pattern(p);
+            }
+            m.compile();
+            return m;
+        }());
+    return matcher;
+}
+
+
+} // no name namespace
+
+
+
+build_log::build_log(snap_builder * sb, build_record const & record)
+    : f_snap_builder(sb)
+    , f_record(record)
+{
+}
+
+
+/** \brief Get the excerpt of the log of this build.
+ *
+ * If the log changed since the last time (or was never downloaded), it
+ * gets downloaded and scanned. Otherwise the excerpt saved in the cache
+ * is used.
+ *
+ * \return true if the excerpt is available.
+ */
+bool build_log::fetch()
+{
+    if(f_record.f_build_log_url.empty())
+    {
+        return false;
+    }
+
+    std::string const basename(get_basename());
+    std::string const log_filename(basename + ".gz");
+    std::string const excerpt_filename(basename + ".excerpt");
+
+    http_client::result_t const result(f_snap_builder->get_http_client()->download(
+              f_record.f_build_log_url
+            , log_filename
+            , excerpt_filename));
+    if(result != http_client::result_t::RESULT_DOWNLOADED)
+    {
+        // use the excerpt we already have, if any
+        //
+        return load_excerpt(excerpt_filename);
+    }
+
+    bool const scanned(scan(log_filename, f_excerpt));
+    snapdev::NOT_USED(unlink(log_filename.c_str()));
+    if(!scanned)
+    {
+        return false;
+    }
+
+    SNAP_LOG_INFO
+        << "found "
+        << f_excerpt.size()
+        << " error line(s) in the build log of "
+        << f_record.f_source_package_name
+        << " v"
+        << f_record.f_source_package_version
+        << " for "
+        << f_record.f_arch_tag
+        << "."
+        << SNAP_LOG_SEND;
+
+    return save_excerpt(excerpt_filename);
+}
+
+
+build_log::lines_t const & build_log::get_excerpt() const
+{
+    return f_excerpt;
+}
+
+
+/** \brief Search a build log for errors.
+ *
+ * The file is decompressed and read one line at a time. Each line gets
+ * checked against all the error patterns at once and only the last
+ * g_excerpt_lines matching lines are kept.
+ *
+ * A file which is not compressed is read as is.
+ *
+ * \param[in] filename  The name of the .txt.gz log.
+ * \param[out] excerpt  The lines which look like errors.
+ *
+ * \return true if the file could be read.
+ */
+bool build_log::scan(std::string const & filename, lines_t & excerpt)
+{
+    gzFile in(gzopen(filename.c_str(), "rb"));
+    if(in == nullptr)
+    {
+        SNAP_LOG_ERROR
+            << "could not open build log \""
+            << filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    pattern_matcher const & matcher(get_error_matcher());
+    std::deque<std::string> lines;
+    std::string line;
+    auto check_line = [&]()
+        {
+            if(matcher.match(line))
+            {
+                lines.push_back(line);
+                if(lines.size() > g_excerpt_lines)
+                {
+                    lines.pop_front();
+                }
+            }
+            line.clear();
+        };
+
+    // gzgets() returns long lines in several chunks, only the beginning
+    // of those lines is kept
+    //
+    char buf[16 * 1024];
+    while(gzgets(in, buf, sizeof(buf)) != nullptr)
+    {
+        std::size_t length(strlen(buf));
+        bool const eol(length > 0 && buf[length - 1] == '\n');
+        if(eol)
+        {
+            --length;
+        }
+        if(line.length() < g_max_line_length)
+        {
+            line.append(buf, std::min(length, g_max_line_length - line.length()));
+        }
+        if(eol)
+        {
+            check_line();
+        }
+    }
+    if(!line.empty())
+    {
+        check_line();
+    }
+
+    int errnum(Z_OK);
+    gzerror(in, &errnum);
+    gzclose(in);
+    if(errnum != Z_OK
+    && errnum != Z_BUF_ERROR)   // truncated file, keep what we found
+    {
+        SNAP_LOG_ERROR
+            << "could not decompress build log \""
+            << filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    excerpt.assign(lines.begin(), lines.end());
+    return true;
+}
+
+
+std::string build_log::get_basename() const
+{
+    return f_snap_builder->get_cache_path()
+         + '/'
+         + f_record.f_source_package_name
+         + '_'
+         + f_record.f_source_package_version
+         + '_'
+         + f_record.f_arch_tag
+         + ".buildlog";
+}
+
+
+bool build_log::load_excerpt(std::string const & filename)
+{
+    std::ifstream in(filename);
+    if(!in.is_open())
+    {
+        return false;
+    }
+
+    f_excerpt.clear();
+    std::string line;
+    while(std::getline(in, line))
+    {
+        f_excerpt.push_back(line);
+    }
+    return true;
+}
+
+
+bool build_log::save_excerpt(std::string const & filename) const
+{
+    std::string const tmp(filename + ".tmp");
+    {
+        std::ofstream out(tmp);
+        for(auto const & l : f_excerpt)
+        {
+            out << l << '\n';
+        }
+        if(!out)
+        {
+            snapdev::NOT_USED(unlink(tmp.c_str()));
+            return false;
+        }
+    }
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        snapdev::NOT_USED(unlink(tmp.c_str()));
+        return false;
+    }
+    return true;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,78 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    "build_record.h"
+
+
+// C++
+//
+#include    <string>
+#include    <vector>
+
+
+
+namespace builder
+{
+
+
+
+class snap_builder;
+
+
+/** \brief Extract the errors from the log of a failed build.
+ *
+ * Launchpad saves the output of each build in a gzip compressed text
+ * file (the build_log_url of the build record). This class downloads
+ * that file, decompresses it line by line and keeps the last few lines
+ * which look like errors (compiler, linker, make, cmake, dh...). The
+ * whole log is never loaded in memory and it is deleted once scanned.
+ *
+ * The excerpt is saved in the cache. The download is conditional
+ * against that excerpt so the log is only downloaded again if it
+ * changed.
+ */
+class build_log
+{
+public:
+    typedef std::vector<std::string>    lines_t;
+
+                                build_log(snap_builder * sb, build_record const & record);
+
+    bool                        fetch();
+    lines_t const &             get_excerpt() const;
+
+    static bool                 scan(std::string const & filename, lines_t & excerpt);
+
+private:
+    std::string                 get_basename() const;
+    bool                        load_excerpt(std::string const & filename);
+    bool                        save_excerpt(std::string const & filename) const;
+
+    snap_builder *              f_snap_builder = nullptr;
+    build_record                f_record = build_record();
+    lines_t                     f_excerpt = lines_t();
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
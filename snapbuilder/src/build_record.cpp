@@ -0,0 +1,764 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "build_record.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <ctime>
+#include    <fstream>
+
+
+// C
+//
+#include    <stdio.h>
+#include    <unistd.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+/** \brief Extract the build records from a JSON stream.
+ *
+ * This is a minimal streaming JSON reader. It only keeps the few string
+ * fields of the entries we are interested in and skips everything else
+ * without creating any object. This is much faster than loading the
+ * whole tree and then copying the fields we need.
+ *
+ * The values being skipped are only checked for balanced brackets and
+ * strings so an invalid JSON file may go through as long as the parts
+ * we read are valid.
+ */
+class json_extractor
+{
+public:
+    enum class status_t
+    {
+        STATUS_OK,
+        STATUS_INVALID,
+        STATUS_NOT_OBJECT,
+        STATUS_NO_ENTRIES,
+        STATUS_EMPTY,
+        STATUS_ENTRIES_NOT_ARRAY,
+    };
+
+                        json_extractor(std::streambuf * in);
+
+    status_t            extract(build_record::vector_t & records, std::string * next_link);
+
+private:
+    int                 next();
+    bool                read_string(std::string & str);
+    bool                skip_string();
+    bool                skip_value(int c);
+    bool                read_entries(build_record::vector_t & records);
+    bool                read_entry(build_record & r);
+
+    std::streambuf *    f_in = nullptr;
+    std::string         f_key = std::string();
+};
+
+
+typedef std::string build_record::*     field_t;
+
+struct field_name_t
+{
+    char const *        f_name = nullptr;
+    field_t             f_field = nullptr;
+};
+
+constexpr field_name_t const g_fields[] =
+{
+    { "source_package_name",    &build_record::f_source_package_name },
+    { "source_package_version", &build_record::f_source_package_version },
+    { "arch_tag",               &build_record::f_arch_tag },
+    { "buildstate",             &build_record::f_buildstate },
+    { "datebuilt",              &build_record::f_datebuilt },
+    { "date_started",           &build_record::f_date_started },
+    { "datecreated",            &build_record::f_datecreated },
+    { "self_link",              &build_record::f_self_link },
+    { "build_log_url",          &build_record::f_build_log_url },
+};
+
+
+field_t get_field(std::string const & name)
+{
+    for(auto const & f : g_fields)
+    {
+        if(name == f.f_name)
+        {
+            return f.f_field;
+        }
+    }
+
+    return nullptr;
+}
+
+
+json_extractor::json_extractor(std::streambuf * in)
+    : f_in(in)
+{
+}
+
+
+json_extractor::status_t json_extractor::extract(
+      build_record::vector_t & records
+    , std::string * next_link)
+{
+    int c(next());
+    if(c != '{')
+    {
+        return c == std::char_traits<char>::eof()
+                    ? status_t::STATUS_INVALID
+                    : status_t::STATUS_NOT_OBJECT;
+    }
+
+    bool found_entries(false);
+    bool entries_not_array(false);
+    bool found_total_size(false);
+
+    c = next();
+    if(c != '}')
+    {
+        for(;;)
+        {
+            if(c != '"'
+            || !read_string(f_key)
+            || next() != ':')
+            {
+                return status_t::STATUS_INVALID;
+            }
+
+            c = next();
+            if(f_key == "entries"
+            && c == '[')
+            {
+                found_entries = true;
+                if(!read_entries(records))
+                {
+                    return status_t::STATUS_INVALID;
+                }
+            }
+            else if(f_key == "next_collection_link"
+                 && c == '"'
+                 && next_link != nullptr)
+            {
+                if(!read_string(*next_link))
+                {
+                    return status_t::STATUS_INVALID;
+                }
+            }
+            else
+            {
+                if(f_key == "entries")
+                {
+                    entries_not_array = true;
+                }
+                else if(f_key == "total_size")
+                {
+                    found_total_size = true;
+                }
+                if(!skip_value(c))
+                {
+                    return status_t::STATUS_INVALID;
+                }
+            }
+
+            c = next();
+            if(c == '}')
+            {
+                break;
+            }
+            if(c != ',')
+            {
+                return status_t::STATUS_INVALID;
+            }
+            c = next();
+        }
+    }
+
+    if(next() != std::char_traits<char>::eof())
+    {
+        return status_t::STATUS_INVALID;
+    }
+
+    if(found_entries)
+    {
+        return status_t::STATUS_OK;
+    }
+    if(entries_not_array)
+    {
+        return status_t::STATUS_ENTRIES_NOT_ARRAY;
+    }
+    if(found_total_size)
+    {
+        return status_t::STATUS_EMPTY;
+    }
+    return status_t::STATUS_NO_ENTRIES;
+}
+
+
+/** \brief Get the next character which is not a space.
+ *
+ * \return The next character or EOF.
+ */
+int json_extractor::next()
+{
+    for(;;)
+    {
+        int const c(f_in->sbumpc());
+        if(c != ' '
+        && c != '\t'
+        && c != '\n'
+        && c != '\r')
+        {
+            return c;
+        }
+    }
+}
+
+
+/** \brief Read a string.
+ *
+ * The opening quote was already read. This function reads up to and
+ * including the closing quote and converts the escape sequences.
+ *
+ * \param[out] str  The string receiving the result.
+ *
+ * \return true if the string was valid.
+ */
+bool json_extractor::read_string(std::string & str)
+{
+    str.clear();
+    for(;;)
+    {
+        int c(f_in->sbumpc());
+        if(c == '"')
+        {
+            return true;
+        }
+        if(c == std::char_traits<char>::eof()
+        || (c >= 0 && c < 0x20))
+        {
+            return false;
+        }
+        if(c != '\\')
+        {
+            str += static_cast<char>(c);
+            continue;
+        }
+
+        c = f_in->sbumpc();
+        switch(c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            str += static_cast<char>(c);
+            break;
+
+        case 'b':
+            str += '\b';
+            break;
+
+        case 'f':
+            str += '\f';
+            break;
+
+        case 'n':
+            str += '\n';
+            break;
+
+        case 'r':
+            str += '\r';
+            break;
+
+        case 't':
+            str += '\t';
+            break;
+
+        case 'u':
+            {
+                char32_t wc(0);
+                for(int idx(0); idx < 4; ++idx)
+                {
+                    c = f_in->sbumpc();
+                    if(c >= '0' && c <= '9')
+                    {
+                        wc = wc * 16 + c - '0';
+                    }
+                    else if(c >= 'a' && c <= 'f')
+                    {
+                        wc = wc * 16 + c - 'a' + 10;
+                    }
+                    else if(c >= 'A' && c <= 'F')
+                    {
+                        wc = wc * 16 + c - 'A' + 10;
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+
+                // the strings we keep are expected to be ASCII, surrogates
+                // are not combined and end up as '?'
+                //
+                if(wc < 0x80)
+                {
+                    str += static_cast<char>(wc);
+                }
+                else if(wc < 0x800)
+                {
+                    str += static_cast<char>(0xC0 | (wc >> 6));
+                    str += static_cast<char>(0x80 | (wc & 0x3F));
+                }
+                else if(wc >= 0xD800 && wc <= 0xDFFF)
+                {
+                    str += '?';
+                }
+                else
+                {
+                    str += static_cast<char>(0xE0 | (wc >> 12));
+                    str += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
+                    str += static_cast<char>(0x80 | (wc & 0x3F));
+                }
+            }
+            break;
+
+        default:
+            return false;
+
+        }
+    }
+}
+
+
+bool json_extractor::skip_string()
+{
+    for(;;)
+    {
+        int const c(f_in->sbumpc());
+        if(c == '"')
+        {
+            return true;
+        }
+        if(c == std::char_traits<char>::eof())
+        {
+            return false;
+        }
+        if(c == '\\')
+        {
+            if(f_in->sbumpc() == std::char_traits<char>::eof())
+            {
+                return false;
+            }
+        }
+    }
+}
+
+
+/** \brief Skip a value.
+ *
+ * \param[in] c  The first character of the value.
+ *
+ * \return true if the value was skipped, false on a syntax error.
+ */
+bool json_extractor::skip_value(int c)
+{
+    switch(c)
+    {
+    case '"':
+        return skip_string();
+
+    case '{':
+    case '[':
+        {
+            int depth(1);
+            for(;;)
+            {
+                c = f_in->sbumpc();
+                switch(c)
+                {
+                case '"':
+                    if(!skip_string())
+                    {
+                        return false;
+                    }
+                    break;
+
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+
+                case '}':
+                case ']':
+                    --depth;
+                    if(depth == 0)
+                    {
+                        return true;
+                    }
+                    break;
+
+                default:
+                    if(c == std::char_traits<char>::eof())
+                    {
+                        return false;
+                    }
+                    break;
+
+                }
+            }
+        }
+
+    case std::char_traits<char>::eof():
+        return false;
+
+    default:
+        // number, true, false, null
+        //
+        if(c != '-'
+        && (c < '0' || c > '9')
+        && (c < 'a' || c > 'z'))
+        {
+            return false;
+        }
+        for(;;)
+        {
+            c = f_in->sgetc();
+            if(c == std::char_traits<char>::eof()
+            || strchr(",}] \t\r\n", c) != nullptr)
+            {
+                return true;
+            }
+            f_in->sbumpc();
+        }
+
+    }
+}
+
+
+bool json_extractor::read_entries(build_record::vector_t & records)
+{
+    int c(next());
+    if(c == ']')
+    {
+        return true;
+    }
+    for(;;)
+    {
+        if(c == '{')
+        {
+            build_record r;
+            if(!read_entry(r))
+            {
+                return false;
+            }
+            records.push_back(std::move(r));
+        }
+        else if(!skip_value(c))
+        {
+            return false;
+        }
+
+        c = next();
+        if(c == ']')
+        {
+            return true;
+        }
+        if(c != ',')
+        {
+            return false;
+        }
+        c = next();
+    }
+}
+
+
+bool json_extractor::read_entry(build_record & r)
+{
+    int c(next());
+    if(c == '}')
+    {
+        return true;
+    }
+    for(;;)
+    {
+        if(c != '"'
+        || !read_string(f_key)
+        || next() != ':')
+        {
+            return false;
+        }
+
+        c = next();
+        field_t const field(get_field(f_key));
+        if(field != nullptr
+        && c == '"')
+        {
+            if(!read_string(r.*field))
+            {
+                return false;
+            }
+        }
+        else if(!skip_value(c))
+        {
+            return false;
+        }
+
+        c = next();
+        if(c == '}')
+        {
+            return true;
+        }
+        if(c != ',')
+        {
+            return false;
+        }
+        c = next();
+    }
+}
+
+
+} // no name namespace
+
+
+
+/** \brief Check whether the build reached a final state.
+ *
+ * A build which is waiting or currently building is going to change
+ * state later. All the other states are final.
+ *
+ * \return true if the state of this build is not going to change.
+ */
+bool build_record::is_final() const
+{
+    return f_buildstate != "Needs building"
+        && f_buildstate != "Currently building"
+        && f_buildstate != "Uploading build"
+        && f_buildstate != "Cancelling build";
+}
+
+
+/** \brief Convert a Launchpad date to microseconds.
+ *
+ * Launchpad dates look like "2022-02-01T03:45:14.192170+00:00". They are
+ * always in UTC.
+ *
+ * \param[in] date  The date to convert.
+ *
+ * \return The number of microseconds since the epoch, or 0 if \p date is
+ * empty or invalid.
+ */
+std::int64_t date_to_us(std::string const & date)
+{
+    tm t = {};
+    int us(0);
+    int const count(sscanf(
+              date.c_str()
+            , "%d-%d-%dT%d:%d:%d.%d"
+            , &t.tm_year
+            , &t.tm_mon
+            , &t.tm_mday
+            , &t.tm_hour
+            , &t.tm_min
+            , &t.tm_sec
+            , &us));
+    if(count < 6)
+    {
+        return 0;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+
+    return static_cast<std::int64_t>(timegm(&t)) * 1'000'000 + us;
+}
+
+
+/** \brief Convert microseconds back to a Launchpad date.
+ *
+ * This is the inverse of date_to_us(). The date is always output in UTC
+ * with microseconds so the result can be compared with the dates found
+ * in the Launchpad JSON as strings.
+ *
+ * \param[in] us  The number of microseconds since the epoch.
+ *
+ * \return The date as a string or an empty string if \p us is 0.
+ */
+std::string us_to_date(std::int64_t us)
+{
+    if(us == 0)
+    {
+        return std::string();
+    }
+
+    time_t const seconds(us / 1'000'000);
+    tm t;
+    gmtime_r(&seconds, &t);
+
+    char buf[64];
+    snprintf(
+              buf
+            , sizeof(buf)
+            , "%04d-%02d-%02dT%02d:%02d:%02d.%06d+00:00"
+            , t.tm_year + 1900
+            , t.tm_mon + 1
+            , t.tm_mday
+            , t.tm_hour
+            , t.tm_min
+            , t.tm_sec
+            , static_cast<int>(us % 1'000'000));
+    return buf;
+}
+
+
+/** \brief Load the build records found in a Launchpad JSON file.
+ *
+ * The file is expected to be the result of a getBuildRecords request.
+ * The fields we are interested in are copied in \p records, in the
+ * order they appear in the file (Launchpad returns the newest first).
+ *
+ * If the file is not valid JSON, it gets deleted.
+ *
+ * \param[in] filename  The name of the JSON file to load.
+ * \param[out] records  The vector where the records get added.
+ * \param[out] next_link  If not nullptr, receives the URL of the next
+ * page of records or an empty string if this was the last page.
+ * \param[out] empty  If not nullptr, set to true when the file only
+ * has a "total_size" field, meaning that the project was never built.
+ *
+ * \return true if the records were loaded.
+ */
+bool load_build_records(
+      std::string const & filename
+    , build_record::vector_t & records
+    , std::string * next_link
+    , bool * empty)
+{
+    if(empty != nullptr)
+    {
+        *empty = false;
+    }
+
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if(!in.is_open())
+    {
+        SNAP_LOG_ERROR
+            << "could not open \""
+            << filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    if(next_link != nullptr)
+    {
+        next_link->clear();
+    }
+
+    // on an error, do not keep the records read so far
+    //
+    std::size_t const size(records.size());
+    json_extractor extractor(in.rdbuf());
+    json_extractor::status_t const status(extractor.extract(records, next_link));
+    if(status != json_extractor::status_t::STATUS_OK)
+    {
+        records.resize(size);
+    }
+
+    switch(status)
+    {
+    case json_extractor::status_t::STATUS_OK:
+        return true;
+
+    case json_extractor::status_t::STATUS_INVALID:
+        SNAP_LOG_ERROR
+            << "file \""
+            << filename
+            << "\" does not represent a valid JSON file. Deleting."
+            << SNAP_LOG_SEND;
+        unlink(filename.c_str());
+        return false;
+
+    case json_extractor::status_t::STATUS_NOT_OBJECT:
+        SNAP_LOG_ERROR
+            << "JSON found in cache file \""
+            << filename
+            << "\" does not represent an object."
+            << SNAP_LOG_SEND;
+        return false;
+
+    case json_extractor::status_t::STATUS_EMPTY:
+        // if not empty, we have a "total_size_link" instead
+        //
+        // this happens whenever we create a new project and we have not
+        // yet compiled it on launchpad
+        //
+        if(empty != nullptr)
+        {
+            *empty = true;
+        }
+        SNAP_LOG_ERROR
+            << "JSON found in cache file \""
+            << filename
+            << "\" has a \"total_size\" field which means it is empty."
+            << SNAP_LOG_SEND;
+        return false;
+
+    case json_extractor::status_t::STATUS_ENTRIES_NOT_ARRAY:
+        SNAP_LOG_ERROR
+            << "JSON found in cache file \""
+            << filename
+            << "\" has an \"entries\" field, but it is not an array."
+            << SNAP_LOG_SEND;
+        return false;
+
+    case json_extractor::status_t::STATUS_NO_ENTRIES:
+        break;
+
+    }
+
+    SNAP_LOG_ERROR
+        << "JSON found in cache file \""
+        << filename
+        << "\" has no \"entries\" field."
+        << SNAP_LOG_SEND;
+    return false;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,71 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <vector>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief One build record as found in the Launchpad JSON.
+ *
+ * Launchpad returns build records with many fields. We only keep the
+ * few fields we use to determine the state of a project.
+ *
+ * The dates are kept as strings in the ISO 8601 format Launchpad uses
+ * (all in UTC) so they can be compared as is.
+ */
+struct build_record
+{
+    typedef std::vector<build_record>       vector_t;
+
+    bool                        is_final() const;
+
+    std::string                 f_source_package_name = std::string();
+    std::string                 f_source_package_version = std::string();
+    std::string                 f_arch_tag = std::string();
+    std::string                 f_buildstate = std::string();
+    std::string                 f_datebuilt = std::string();
+    std::string                 f_date_started = std::string();
+    std::string                 f_datecreated = std::string();
+    std::string                 f_self_link = std::string();
+    std::string                 f_build_log_url = std::string();
+};
+
+
+bool                            load_build_records(
+                                      std::string const & filename
+                                    , build_record::vector_t & records
+                                    , std::string * next_link = nullptr
+                                    , bool * empty = nullptr);
+std::int64_t                    date_to_us(std::string const & date);
+std::string                     us_to_date(std::int64_t us);
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
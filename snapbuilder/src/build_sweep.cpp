@@ -0,0 +1,247 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "build_sweep.h"
+
+#include    "snap_builder.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// the watch jobs run once a minute, one sweep per round is enough
+//
+constexpr time_t const      g_sweep_interval = 50;
+
+// never read more than this many pages in one sweep
+//
+constexpr std::size_t const g_max_pages = 10;
+
+
+} // no name namespace
+
+
+
+build_sweep::build_sweep(snap_builder * sb)
+    : f_snap_builder(sb)
+{
+}
+
+
+/** \brief Register a project as being watched.
+ *
+ * Only the records of watched projects are kept by the sweep.
+ *
+ * \param[in] name  The name of the project (its source package name).
+ * \param[in] since  The creation date of the oldest build of this project
+ * which may still change state. The sweep reads pages until it reaches
+ * records older than that date.
+ */
+void build_sweep::watch(std::string const & name, std::string const & since)
+{
+    cppthread::guard lock(f_mutex);
+    f_watched[name] = since;
+}
+
+
+void build_sweep::unwatch(std::string const & name)
+{
+    cppthread::guard lock(f_mutex);
+    f_watched.erase(name);
+    f_records.erase(name);
+}
+
+
+/** \brief Read the latest build records of the PPA.
+ *
+ * If the last sweep is recent enough, this function returns immediately.
+ * If another thread is sweeping, the function waits for that sweep to
+ * be over.
+ *
+ * \return false if the records could not be retrieved.
+ */
+bool build_sweep::sweep()
+{
+    std::string watermark;
+    {
+        cppthread::guard lock(f_mutex);
+        while(f_sweeping)
+        {
+            f_mutex.wait();
+        }
+        if(f_watched.empty()
+        || time(nullptr) - f_last_sweep < g_sweep_interval)
+        {
+            return true;
+        }
+
+        // we need all the records newer than the ones of the last sweep
+        // and the ones still in progress in the watched projects
+        //
+        // (an empty date means we know nothing about that project so
+        // we read as many pages as we can)
+        //
+        watermark = f_newest_datecreated;
+        for(auto const & w : f_watched)
+        {
+            if(w.second.empty())
+            {
+                watermark.clear();
+                break;
+            }
+            if(watermark.empty()
+            || w.second < watermark)
+            {
+                watermark = w.second;
+            }
+        }
+        f_sweeping = true;
+    }
+
+    build_record::vector_t records;
+    std::string newest;
+    bool const result(read_pages(watermark, records, newest));
+
+    cppthread::guard lock(f_mutex);
+    f_sweeping = false;
+    f_mutex.broadcast();
+
+    if(!result)
+    {
+        return false;
+    }
+
+    f_last_sweep = time(nullptr);
+    if(newest > f_newest_datecreated)
+    {
+        f_newest_datecreated = newest;
+    }
+
+    for(auto const & r : records)
+    {
+        if(f_watched.find(r.f_source_package_name) != f_watched.end())
+        {
+            f_records[r.f_source_package_name].push_back(r);
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Retrieve the records found for one project.
+ *
+ * The records are removed from the sweep.
+ *
+ * \param[in] name  The name of the project.
+ *
+ * \return The records found for that project since the last call.
+ */
+build_record::vector_t build_sweep::take_records(std::string const & name)
+{
+    build_record::vector_t result;
+
+    cppthread::guard lock(f_mutex);
+    auto it(f_records.find(name));
+    if(it != f_records.end())
+    {
+        result.swap(it->second);
+        f_records.erase(it);
+    }
+
+    return result;
+}
+
+
+bool build_sweep::read_pages(
+      std::string const & watermark
+    , build_record::vector_t & records
+    , std::string & newest)
+{
+    std::string url(f_snap_builder->get_sweep_url());
+    for(std::size_t page(0); page < g_max_pages && !url.empty(); ++page)
+    {
+        std::string const filename(
+                  f_snap_builder->get_cache_path()
+                + "/sweep-"
+                + std::to_string(page)
+                + ".json");
+        if(f_snap_builder->get_http_client()->download(url, filename)
+                                        == http_client::result_t::RESULT_FAILED)
+        {
+            return false;
+        }
+
+        build_record::vector_t page_records;
+        if(!load_build_records(filename, page_records, &url))
+        {
+            return false;
+        }
+
+        for(auto const & r : page_records)
+        {
+            if(r.f_datecreated > newest)
+            {
+                newest = r.f_datecreated;
+            }
+
+            if(!watermark.empty()
+            && r.f_datecreated < watermark)
+            {
+                // the records are sorted, the remaining ones are older
+                //
+                SNAP_LOG_TRACE
+                    << "sweep stopped on page "
+                    << page + 1
+                    << " with "
+                    << records.size()
+                    << " new or pending records."
+                    << SNAP_LOG_SEND;
+                return true;
+            }
+
+            records.push_back(r);
+        }
+    }
+
+    return true;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,99 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    "build_record.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <ctime>
+#include    <map>
+#include    <memory>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+class snap_builder;
+
+
+/** \brief Retrieve the build records of the whole PPA at once.
+ *
+ * Instead of sending one getBuildRecords request per project being
+ * watched, the sweep sends one request for the entire PPA and routes
+ * each record to its project using the source_package_name field.
+ *
+ * The records are returned by Launchpad from the newest to the oldest.
+ * The sweep reads the following pages only until it reaches records
+ * older than the newest record found in the previous sweep. Since a
+ * build which is not yet done changes state without changing its
+ * creation date, the watched projects also tell the sweep how far back
+ * it has to go to find their builds still in progress.
+ *
+ * The sweep is shared by all the workers; a sweep happens at most once
+ * per interval whatever the number of projects being watched.
+ */
+class build_sweep
+{
+public:
+    typedef std::shared_ptr<build_sweep>        pointer_t;
+
+                                build_sweep(snap_builder * sb);
+                                build_sweep(build_sweep const &) = delete;
+    build_sweep &               operator = (build_sweep const &) = delete;
+
+    void                        watch(std::string const & name, std::string const & since);
+    void                        unwatch(std::string const & name);
+    bool                        sweep();
+    build_record::vector_t      take_records(std::string const & name);
+
+private:
+    typedef std::map<std::string, std::string>              watch_map_t;
+    typedef std::map<std::string, build_record::vector_t>   record_map_t;
+
+    bool                        read_pages(
+                                      std::string const & watermark
+                                    , build_record::vector_t & records
+                                    , std::string & newest);
+
+    snap_builder *              f_snap_builder = nullptr;
+    cppthread::mutex            f_mutex = cppthread::mutex();
+    watch_map_t                 f_watched = watch_map_t();
+    record_map_t                f_records = record_map_t();
+    std::string                 f_newest_datecreated = std::string();
+    time_t                      f_last_sweep = 0;
+    bool                        f_sweeping = false;
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
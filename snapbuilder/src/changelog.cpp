@@ -0,0 +1,386 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "changelog.h"
+
+
+// snapdev
+//
+#include    <snapdev/trim_string.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <stdio.h>
+#include    <unistd.h>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Read the top entry of a changelog.
+ *
+ * This function reads the header, the changes and the trailer of the
+ * first entry of the changelog. The rest of the file is ignored.
+ *
+ * \param[in] filename  The path to the debian/changelog file.
+ *
+ * \return true if the entry was read successfully.
+ */
+bool changelog::read(std::string const & filename)
+{
+    std::ifstream in(filename);
+    if(!in.is_open())
+    {
+        f_error = "could not open \"" + filename + "\".";
+        return false;
+    }
+
+    bool found_header(false);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(!found_header)
+        {
+            if(snapdev::trim_string(line).empty())
+            {
+                continue;
+            }
+            if(!parse_header(line))
+            {
+                f_error = "invalid header \"" + line + "\" in \"" + filename + "\".";
+                return false;
+            }
+            found_header = true;
+        }
+        else if(line.compare(0, 4, " -- ") == 0)
+        {
+            if(!parse_trailer(line))
+            {
+                f_error = "invalid trailer \"" + line + "\" in \"" + filename + "\".";
+                return false;
+            }
+            return true;
+        }
+        else if(line.compare(0, 2, "  ") == 0)
+        {
+            f_changes.push_back(line.substr(2));
+        }
+    }
+
+    f_error = "first entry of \"" + filename + "\" is incomplete.";
+    return false;
+}
+
+
+/** \brief Parse the header of an entry.
+ *
+ * The header has the following format:
+ *
+ * \code
+ * <package> (<version>) <distribution>; urgency=<urgency>
+ * \endcode
+ *
+ * \param[in] line  The header line.
+ *
+ * \return true if the header is valid.
+ */
+bool changelog::parse_header(std::string const & line)
+{
+    std::string::size_type const open(line.find(" ("));
+    if(open == std::string::npos)
+    {
+        return false;
+    }
+    std::string::size_type const close(line.find(')', open));
+    if(close == std::string::npos)
+    {
+        return false;
+    }
+    std::string::size_type const semicolon(line.find(';', close));
+    if(semicolon == std::string::npos)
+    {
+        return false;
+    }
+
+    f_package = line.substr(0, open);
+    f_version = line.substr(open + 2, close - open - 2);
+    f_distribution = snapdev::trim_string(line.substr(close + 1, semicolon - close - 1));
+
+    std::string::size_type const urgency(line.find("urgency=", semicolon));
+    if(urgency != std::string::npos)
+    {
+        f_urgency = snapdev::trim_string(line.substr(urgency + 8));
+        std::string::size_type const comma(f_urgency.find(','));
+        if(comma != std::string::npos)
+        {
+            f_urgency = f_urgency.substr(0, comma);
+        }
+    }
+
+    f_changes.clear();
+    f_maintainer.clear();
+    f_date.clear();
+
+    return !f_package.empty() && !f_version.empty();
+}
+
+
+/** \brief Parse the trailer of an entry.
+ *
+ * The trailer has the following format (note the two spaces between the
+ * maintainer and the date):
+ *
+ * \code
+ *  -- <name> <<email>>  <date>
+ * \endcode
+ *
+ * \param[in] line  The trailer line.
+ *
+ * \return true if the trailer is valid.
+ */
+bool changelog::parse_trailer(std::string const & line)
+{
+    std::string::size_type const separator(line.find(">  ", 4));
+    if(separator == std::string::npos)
+    {
+        return false;
+    }
+
+    f_maintainer = line.substr(4, separator + 1 - 4);
+    f_date = snapdev::trim_string(line.substr(separator + 3));
+
+    // remove the empty lines around the changes
+    //
+    while(!f_changes.empty() && snapdev::trim_string(f_changes.back()).empty())
+    {
+        f_changes.pop_back();
+    }
+    while(!f_changes.empty() && snapdev::trim_string(f_changes.front()).empty())
+    {
+        f_changes.erase(f_changes.begin());
+    }
+
+    return true;
+}
+
+
+/** \brief Add this entry at the top of a changelog.
+ *
+ * This function writes this entry followed by the existing content of
+ * \p filename to a temporary file and then renames that file. This way
+ * the changelog is never left half written.
+ *
+ * \param[in] filename  The path to the debian/changelog file.
+ *
+ * \return true if the new entry was saved.
+ */
+bool changelog::prepend_entry(std::string const & filename) const
+{
+    std::string const tmp(filename + ".tmp");
+    {
+        std::ofstream out(tmp);
+        if(!out.is_open())
+        {
+            f_error = "could not create \"" + tmp + "\".";
+            return false;
+        }
+
+        out << f_package
+            << " ("
+            << f_version
+            << ") "
+            << f_distribution
+            << "; urgency="
+            << f_urgency
+            << "\n\n";
+        for(auto const & c : f_changes)
+        {
+            out << "  " << c << '\n';
+        }
+        out << "\n -- "
+            << f_maintainer
+            << "  "
+            << f_date
+            << "\n\n";
+
+        std::ifstream in(filename);
+        if(in.is_open())
+        {
+            out << in.rdbuf();
+        }
+
+        out.flush();
+        if(!out)
+        {
+            f_error = "could not write \"" + tmp + "\".";
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        f_error = "could not rename \"" + tmp + "\" to \"" + filename + "\".";
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+void changelog::set_package(std::string const & package)
+{
+    f_package = package;
+}
+
+
+void changelog::set_version(std::string const & version)
+{
+    f_version = version;
+}
+
+
+void changelog::set_distribution(std::string const & distribution)
+{
+    f_distribution = distribution;
+}
+
+
+void changelog::set_urgency(std::string const & urgency)
+{
+    f_urgency = urgency;
+}
+
+
+void changelog::set_changes(advgetopt::string_list_t const & changes)
+{
+    f_changes = changes;
+}
+
+
+void changelog::set_maintainer(std::string const & maintainer)
+{
+    f_maintainer = maintainer;
+}
+
+
+void changelog::set_date(std::string const & date)
+{
+    f_date = date;
+}
+
+
+/** \brief Set the date from a Unix timestamp.
+ *
+ * The date is formatted as expected in a changelog (RFC 2822). The day
+ * and month names are not localized.
+ *
+ * \param[in] date  The date to save in the entry.
+ */
+void changelog::set_date(time_t date)
+{
+    static char const * const g_days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static char const * const g_months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    struct tm t;
+    localtime_r(&date, &t);
+
+    char zone[16];
+    strftime(zone, sizeof(zone), "%z", &t);
+
+    char buf[64];
+    snprintf(
+          buf
+        , sizeof(buf)
+        , "%s, %02d %s %04d %02d:%02d:%02d %s"
+        , g_days[t.tm_wday]
+        , t.tm_mday
+        , g_months[t.tm_mon]
+        , t.tm_year + 1900
+        , t.tm_hour
+        , t.tm_min
+        , t.tm_sec
+        , zone);
+    f_date = buf;
+}
+
+
+std::string const & changelog::get_package() const
+{
+    return f_package;
+}
+
+
+std::string const & changelog::get_version() const
+{
+    return f_version;
+}
+
+
+std::string const & changelog::get_distribution() const
+{
+    return f_distribution;
+}
+
+
+std::string const & changelog::get_urgency() const
+{
+    return f_urgency;
+}
+
+
+advgetopt::string_list_t const & changelog::get_changes() const
+{
+    return f_changes;
+}
+
+
+std::string const & changelog::get_maintainer() const
+{
+    return f_maintainer;
+}
+
+
+std::string const & changelog::get_date() const
+{
+    return f_date;
+}
+
+
+std::string const & changelog::get_error() const
+{
+    return f_error;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
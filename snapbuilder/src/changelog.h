@@ -0,0 +1,96 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// advgetopt
+//
+#include    <advgetopt/utils.h>
+
+
+// C++
+//
+#include    <ctime>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Read and write the top entry of a debian/changelog file.
+ *
+ * A changelog entry looks like this:
+ *
+ * \code
+ * snapbuilder (1.0.0.0~jammy) jammy; urgency=high
+ *
+ *   * This is a change.
+ *
+ *  -- Alexis Wilke <alexis@m2osw.com>  Sat, 15 May 2021 12:52:16 -0700
+ * \endcode
+ *
+ * The read() function only reads the file up to the end of the first
+ * entry so it is fast even on very long changelogs. This replaces
+ * running dpkg-parsechangelog and dch.
+ */
+class changelog
+{
+public:
+    bool                        read(std::string const & filename);
+    bool                        prepend_entry(std::string const & filename) const;
+
+    void                        set_package(std::string const & package);
+    void                        set_version(std::string const & version);
+    void                        set_distribution(std::string const & distribution);
+    void                        set_urgency(std::string const & urgency);
+    void                        set_changes(advgetopt::string_list_t const & changes);
+    void                        set_maintainer(std::string const & maintainer);
+    void                        set_date(std::string const & date);
+    void                        set_date(time_t date);
+
+    std::string const &         get_package() const;
+    std::string const &         get_version() const;
+    std::string const &         get_distribution() const;
+    std::string const &         get_urgency() const;
+    advgetopt::string_list_t const &
+                                get_changes() const;
+    std::string const &         get_maintainer() const;
+    std::string const &         get_date() const;
+    std::string const &         get_error() const;
+
+private:
+    bool                        parse_header(std::string const & line);
+    bool                        parse_trailer(std::string const & line);
+
+    std::string                 f_package = std::string();
+    std::string                 f_version = std::string();
+    std::string                 f_distribution = std::string();
+    std::string                 f_urgency = std::string();
+    advgetopt::string_list_t    f_changes = advgetopt::string_list_t();
+    std::string                 f_maintainer = std::string();
+    std::string                 f_date = std::string();
+    mutable std::string         f_error = std::string();
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,883 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "http_client.h"
+
+#include    "version.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/join_strings.h>
+#include    <snapdev/not_used.h>
+#include    <snapdev/to_lower.h>
+#include    <snapdev/trim_string.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <stdlib.h>
+#include    <unistd.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+constexpr std::string_view  g_user_agent_name = "snapbuilder";
+constexpr std::string_view  g_user_agent_version = SNAPBUILDER_VERSION_STRING;
+constexpr std::string_view  g_user_agent_platform = "Linux; Ubuntu; x86_64";
+constexpr std::string_view  g_user_agent_curl = "curl/8.5.0+";
+
+constexpr std::string_view  g_user_agent_space = " ";
+constexpr std::string_view  g_user_agent_separator = "/";
+constexpr std::string_view  g_user_agent_open_parenthesis = "(";
+constexpr std::string_view  g_user_agent_close_parenthesis = ")";
+
+constexpr std::string_view  g_curl_user_agent =
+    snapdev::join_string_views<
+        g_user_agent_name,
+        g_user_agent_separator,
+        g_user_agent_version,
+        g_user_agent_space,
+        g_user_agent_open_parenthesis,
+        g_user_agent_platform,
+        g_user_agent_close_parenthesis,
+        g_user_agent_space,
+        g_user_agent_curl>;
+
+
+// a transfer which takes longer than that is considered to have failed
+//
+constexpr long const        g_transfer_timeout = 5 * 60;
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize the HTTP client.
+ *
+ * \param[in] max_connections  The maximum number of connections opened
+ * simultaneously. Additional transfers wait for a connection to be
+ * available.
+ */
+http_client::http_client(std::size_t max_connections)
+    : runner("http_client")
+    , f_max_connections(max_connections)
+    , f_multi(curl_multi_init())
+    , f_share(curl_share_init())
+{
+    curl_multi_setopt(f_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(f_max_connections));
+    curl_multi_setopt(f_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    curl_share_setopt(f_share, CURLSHOPT_LOCKFUNC, &http_client::share_lock);
+    curl_share_setopt(f_share, CURLSHOPT_UNLOCKFUNC, &http_client::share_unlock);
+    curl_share_setopt(f_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(f_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(f_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(f_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+
+http_client::~http_client()
+{
+    curl_multi_cleanup(f_multi);
+    curl_share_cleanup(f_share);
+}
+
+
+void http_client::start()
+{
+    f_thread = std::make_shared<cppthread::thread>("http_client", this);
+    f_thread->start();
+}
+
+
+void http_client::stop()
+{
+    {
+        cppthread::guard lock(f_mutex);
+        f_done = true;
+    }
+    curl_multi_wakeup(f_multi);
+
+    if(f_thread != nullptr)
+    {
+        f_thread->stop();
+        f_thread.reset();
+    }
+}
+
+
+/** \brief Attach the object tracking the health of launchpad.
+ *
+ * \param[in] health  The remote health object shared by all the requests.
+ */
+void http_client::set_remote_health(remote_health::pointer_t health)
+{
+    cppthread::guard lock(f_mutex);
+    f_remote_health = health;
+}
+
+
+/** \brief Start downloading a file.
+ *
+ * This function adds a request to download \p url to \p filename. It
+ * returns immediately. The \p done callback is called from the HTTP
+ * client thread once the transfer is over.
+ *
+ * If the same URL is already being downloaded to the same file, the
+ * callback is attached to that request instead.
+ *
+ * The ETag and Last-Modified of the previous download are only sent if
+ * the data of that download is still available. By default, that is the
+ * \p filename itself. When the caller converts the downloaded file to
+ * another format and deletes it, it passes the name of the converted
+ * file in \p cache_filename instead.
+ *
+ * \param[in] url  The URL of the file to download.
+ * \param[in] filename  The file where the data gets saved.
+ * \param[in] done  The callback called once the transfer is over.
+ * \param[in] cache_filename  The file which has to exist for the
+ * request to be conditional; if empty, \p filename is used.
+ */
+void http_client::start_download(
+      std::string const & url
+    , std::string const & filename
+    , done_t done
+    , std::string const & cache_filename)
+{
+    request_t::pointer_t r(std::make_shared<request_t>());
+    r->f_url = url;
+    r->f_filename = filename;
+    r->f_cache_filename = cache_filename.empty() ? filename : cache_filename;
+    add_request(r, done);
+}
+
+
+void http_client::add_request(request_t::pointer_t r, done_t done)
+{
+    {
+        cppthread::guard lock(f_mutex);
+
+        if(!f_done)
+        {
+            std::string const key(get_key(r));
+            auto it(f_requests.find(key));
+            if(it != f_requests.end())
+            {
+                SNAP_LOG_TRACE
+                    << "request for \""
+                    << r->f_url
+                    << "\" already in progress."
+                    << SNAP_LOG_SEND;
+                if(done != nullptr)
+                {
+                    it->second->f_done.push_back(done);
+                }
+                return;
+            }
+
+            if(f_remote_health != nullptr
+            && !f_remote_health->allow_request())
+            {
+                SNAP_LOG_TRACE
+                    << "launchpad is not available, request for \""
+                    << r->f_url
+                    << "\" not sent."
+                    << SNAP_LOG_SEND;
+                if(done == nullptr)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                if(done != nullptr)
+                {
+                    r->f_done.push_back(done);
+                }
+                f_requests[key] = r;
+                f_new_requests.push_back(r);
+                done = done_t();
+            }
+        }
+    }
+
+    if(done != nullptr)
+    {
+        // we are stopping or launchpad is not available
+        //
+        done(result_t::RESULT_FAILED, 0);
+        return;
+    }
+
+    curl_multi_wakeup(f_multi);
+}
+
+
+/** \brief Check whether a transfer failed because of the server.
+ *
+ * Timeouts, connection errors and 5xx or 429 answers mean that the
+ * server is not able to answer our requests at the moment. Other errors
+ * (i.e. a 404, a local file error) do not say anything about the state
+ * of the server.
+ *
+ * \param[in] code  The curl result of the transfer.
+ * \param[in] response_code  The HTTP response code, 0 if none.
+ *
+ * \return true if the server failed.
+ */
+bool http_client::is_server_failure(CURLcode code, long response_code)
+{
+    switch(code)
+    {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return true;
+
+    default:
+        return response_code >= 500
+            || response_code == 429;
+
+    }
+}
+
+
+std::string http_client::get_key(request_t::pointer_t r)
+{
+    return (r->f_head ? "HEAD " : "GET ") + r->f_url + '\n' + r->f_filename;
+}
+
+
+/** \brief Download a file and wait for the transfer to be over.
+ *
+ * This function is used by the worker threads which need the file
+ * before they can continue their job.
+ *
+ * \param[in] url  The URL of the file to download.
+ * \param[in] filename  The file where the data gets saved.
+ * \param[in] cache_filename  The file which has to exist for the
+ * request to be conditional; if empty, \p filename is used.
+ *
+ * \return RESULT_DOWNLOADED if the file was downloaded,
+ * RESULT_NOT_MODIFIED if the existing file is still current, and
+ * RESULT_FAILED otherwise.
+ */
+http_client::result_t http_client::download(
+      std::string const & url
+    , std::string const & filename
+    , std::string const & cache_filename)
+{
+    struct state_t
+    {
+        bool        f_done = false;
+        result_t    f_result = result_t::RESULT_FAILED;
+    };
+    std::shared_ptr<state_t> state(std::make_shared<state_t>());
+
+    start_download(url, filename, [this, state](result_t result, long response_code)
+        {
+            snapdev::NOT_USED(response_code);
+
+            cppthread::guard lock(f_mutex);
+            state->f_result = result;
+            state->f_done = true;
+            f_mutex.broadcast();
+        }
+        , cache_filename);
+
+    cppthread::guard lock(f_mutex);
+    while(!state->f_done)
+    {
+        f_mutex.wait();
+    }
+    return state->f_result;
+}
+
+
+/** \brief Send a HEAD request.
+ *
+ * The request is added to the queue and sent as soon as possible. Many
+ * HEAD requests can be sent at once; they get multiplexed over the
+ * shared connections. Redirects are not followed so the \p done callback
+ * receives the 3XX response code as is.
+ *
+ * The \p done callback is called from the HTTP client thread.
+ *
+ * \param[in] url  The URL to check.
+ * \param[in] done  The callback called once the response was received.
+ */
+void http_client::start_head(std::string const & url, done_t done)
+{
+    request_t::pointer_t r(std::make_shared<request_t>());
+    r->f_url = url;
+    r->f_head = true;
+    add_request(r, done);
+}
+
+
+/** \brief Send a HEAD request and wait for the response.
+ *
+ * Redirects are not followed so the caller can see a 3XX response code.
+ *
+ * \param[in] url  The URL to check.
+ *
+ * \return The HTTP response code or -1 if the request failed.
+ */
+long http_client::head(std::string const & url)
+{
+    struct state_t
+    {
+        bool        f_done = false;
+        long        f_response_code = -1;
+    };
+    std::shared_ptr<state_t> state(std::make_shared<state_t>());
+
+    start_head(url, [this, state](result_t result, long response_code)
+        {
+            cppthread::guard lock(f_mutex);
+            state->f_response_code = result == result_t::RESULT_FAILED
+                                            ? -1
+                                            : response_code;
+            state->f_done = true;
+            f_mutex.broadcast();
+        });
+
+    cppthread::guard lock(f_mutex);
+    while(!state->f_done)
+    {
+        f_mutex.wait();
+    }
+    return state->f_response_code;
+}
+
+
+http_client::statistics_t http_client::get_statistics() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_statistics;
+}
+
+
+std::string_view http_client::get_user_agent()
+{
+    return g_curl_user_agent;
+}
+
+
+void http_client::run()
+{
+    while(continue_running())
+    {
+        {
+            cppthread::guard lock(f_mutex);
+            if(f_done)
+            {
+                break;
+            }
+        }
+
+        add_new_requests();
+
+        int running(0);
+        curl_multi_perform(f_multi, &running);
+
+        read_done_transfers();
+
+        curl_multi_poll(f_multi, nullptr, 0, 1000, nullptr);
+    }
+
+    // cancel whatever is left so nobody waits forever
+    //
+    for(auto const & t : f_transfers)
+    {
+        curl_multi_remove_handle(f_multi, t.first);
+        release_request(t.second);
+        snapdev::NOT_USED(unlink(t.second->f_tmp_filename.c_str()));
+        finish_request(t.second, result_t::RESULT_FAILED, 0);
+    }
+    f_transfers.clear();
+
+    std::deque<request_t::pointer_t> left;
+    {
+        cppthread::guard lock(f_mutex);
+        left.swap(f_new_requests);
+    }
+    for(auto const & r : left)
+    {
+        finish_request(r, result_t::RESULT_FAILED, 0);
+    }
+}
+
+
+void http_client::add_new_requests()
+{
+    std::deque<request_t::pointer_t> requests;
+    {
+        cppthread::guard lock(f_mutex);
+        requests.swap(f_new_requests);
+    }
+
+    for(auto const & r : requests)
+    {
+        if(!start_request(r))
+        {
+            finish_request(r, result_t::RESULT_FAILED, 0);
+        }
+    }
+}
+
+
+bool http_client::start_request(request_t::pointer_t r)
+{
+    if(r->f_head)
+    {
+        r->f_easy = curl_easy_init();
+        if(r->f_easy == nullptr)
+        {
+            return false;
+        }
+
+        curl_easy_setopt(r->f_easy, CURLOPT_URL, r->f_url.c_str());
+        curl_easy_setopt(r->f_easy, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(r->f_easy, CURLOPT_DEFAULT_PROTOCOL, "https");
+        setup_easy(r);
+
+        SNAP_LOG_TRACE
+            << "checking \""
+            << r->f_url
+            << "\" with a HEAD request."
+            << SNAP_LOG_SEND;
+
+        f_transfers[r->f_easy] = r;
+        curl_multi_add_handle(f_multi, r->f_easy);
+
+        return true;
+    }
+
+    std::string tmp(r->f_filename + ".XXXXXX");
+    int const fd(mkstemp(tmp.data()));
+    if(fd < 0)
+    {
+        SNAP_LOG_ERROR
+            << "could not create a temporary file to download \""
+            << r->f_url
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    r->f_tmp_filename = tmp;
+    r->f_file = fdopen(fd, "w");
+    if(r->f_file == nullptr)
+    {
+        close(fd);
+        snapdev::NOT_USED(unlink(r->f_tmp_filename.c_str()));
+        return false;
+    }
+
+    r->f_easy = curl_easy_init();
+    if(r->f_easy == nullptr)
+    {
+        release_request(r);
+        snapdev::NOT_USED(unlink(r->f_tmp_filename.c_str()));
+        return false;
+    }
+
+    curl_easy_setopt(r->f_easy, CURLOPT_URL, r->f_url.c_str());
+    curl_easy_setopt(r->f_easy, CURLOPT_WRITEDATA, r->f_file);
+    curl_easy_setopt(r->f_easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(r->f_easy, CURLOPT_FAILONERROR, 1L);
+    setup_easy(r);
+    curl_easy_setopt(r->f_easy, CURLOPT_HEADERFUNCTION, &http_client::header_callback);
+    curl_easy_setopt(r->f_easy, CURLOPT_HEADERDATA, r.get());
+
+    // if we already have that file, only download it if it changed
+    //
+    load_validators(r);
+    if(!r->f_etag.empty())
+    {
+        r->f_headers = curl_slist_append(r->f_headers, ("If-None-Match: " + r->f_etag).c_str());
+    }
+    if(!r->f_last_modified.empty())
+    {
+        r->f_headers = curl_slist_append(r->f_headers, ("If-Modified-Since: " + r->f_last_modified).c_str());
+    }
+    if(r->f_headers != nullptr)
+    {
+        curl_easy_setopt(r->f_easy, CURLOPT_HTTPHEADER, r->f_headers);
+    }
+    r->f_etag.clear();
+    r->f_last_modified.clear();
+
+    SNAP_LOG_INFO
+        << "downloading \""
+        << r->f_url
+        << "\" to \""
+        << r->f_filename
+        << "\"."
+        << SNAP_LOG_SEND;
+
+    f_transfers[r->f_easy] = r;
+    curl_multi_add_handle(f_multi, r->f_easy);
+
+    return true;
+}
+
+
+/** \brief Setup the options common to all the requests.
+ *
+ * This is where the request gets attached to the share handle and asks
+ * for HTTP/2 so it can reuse an existing connection.
+ */
+void http_client::setup_easy(request_t::pointer_t r)
+{
+    curl_easy_setopt(r->f_easy, CURLOPT_SHARE, f_share);
+    curl_easy_setopt(r->f_easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(r->f_easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(r->f_easy, CURLOPT_USERAGENT, g_curl_user_agent.data());
+    curl_easy_setopt(r->f_easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(r->f_easy, CURLOPT_TIMEOUT, g_transfer_timeout);
+}
+
+
+void http_client::read_done_transfers()
+{
+    int left(0);
+    for(CURLMsg * m(curl_multi_info_read(f_multi, &left));
+        m != nullptr;
+        m = curl_multi_info_read(f_multi, &left))
+    {
+        if(m->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        CURL * easy(m->easy_handle);
+        CURLcode const code(m->data.result);
+        auto it(f_transfers.find(easy));
+        if(it == f_transfers.end())
+        {
+            continue;
+        }
+        request_t::pointer_t r(it->second);
+        f_transfers.erase(it);
+
+        long response_code(0);
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &response_code);
+
+        if(f_remote_health != nullptr)
+        {
+            if(is_server_failure(code, response_code))
+            {
+                f_remote_health->report_failure();
+            }
+            else if(code == CURLE_OK
+                 || code == CURLE_HTTP_RETURNED_ERROR)
+            {
+                f_remote_health->report_success();
+            }
+        }
+
+        // a transfer which did not create a new connection reused one
+        // and thus saved the DNS, TCP and TLS handshakes
+        //
+        long new_connections(0);
+        curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &new_connections);
+        {
+            cppthread::guard lock(f_mutex);
+            ++f_statistics.f_requests;
+            f_statistics.f_new_connections += new_connections;
+            if(new_connections == 0
+            && code == CURLE_OK)
+            {
+                ++f_statistics.f_handshakes_saved;
+            }
+        }
+
+        curl_multi_remove_handle(f_multi, easy);
+
+        if(r->f_head)
+        {
+            release_request(r);
+            if(code != CURLE_OK)
+            {
+                SNAP_LOG_ERROR
+                    << "HEAD request to \""
+                    << r->f_url
+                    << "\" failed. ("
+                    << curl_easy_strerror(code)
+                    << ")."
+                    << SNAP_LOG_SEND;
+            }
+            finish_request(
+                  r
+                , code == CURLE_OK
+                        ? result_t::RESULT_DOWNLOADED
+                        : result_t::RESULT_FAILED
+                , response_code);
+            continue;
+        }
+
+        bool const closed(fclose(r->f_file) == 0);
+        r->f_file = nullptr;
+        release_request(r);
+
+        result_t result(result_t::RESULT_FAILED);
+        if(closed && code == CURLE_OK)
+        {
+            if(response_code == 304)
+            {
+                SNAP_LOG_TRACE
+                    << "\""
+                    << r->f_url
+                    << "\" was not modified."
+                    << SNAP_LOG_SEND;
+                snapdev::NOT_USED(unlink(r->f_tmp_filename.c_str()));
+                result = result_t::RESULT_NOT_MODIFIED;
+            }
+            else if(rename(r->f_tmp_filename.c_str(), r->f_filename.c_str()) == 0)
+            {
+                save_validators(r);
+                result = result_t::RESULT_DOWNLOADED;
+            }
+        }
+        if(result == result_t::RESULT_FAILED)
+        {
+            SNAP_LOG_WARNING
+                << "download of \""
+                << r->f_url
+                << "\" failed: "
+                << curl_easy_strerror(code)
+                << SNAP_LOG_SEND;
+            snapdev::NOT_USED(unlink(r->f_tmp_filename.c_str()));
+        }
+
+        finish_request(r, result, response_code);
+    }
+}
+
+
+void http_client::finish_request(request_t::pointer_t r, result_t result, long response_code)
+{
+    // remove the request and grab its callbacks at once so a new request
+    // for the same URL either gets attached here or creates a new request
+    //
+    std::vector<done_t> callbacks;
+    {
+        cppthread::guard lock(f_mutex);
+        callbacks.swap(r->f_done);
+        auto it(f_requests.find(get_key(r)));
+        if(it != f_requests.end()
+        && it->second == r)
+        {
+            f_requests.erase(it);
+        }
+    }
+
+    for(auto const & c : callbacks)
+    {
+        c(result, response_code);
+    }
+}
+
+
+void http_client::share_lock(
+      CURL * handle
+    , curl_lock_data data
+    , curl_lock_access access
+    , void * userptr)
+{
+    snapdev::NOT_USED(handle, access);
+    static_cast<http_client *>(userptr)->f_share_mutexes[data].lock();
+}
+
+
+void http_client::share_unlock(
+      CURL * handle
+    , curl_lock_data data
+    , void * userptr)
+{
+    snapdev::NOT_USED(handle);
+    static_cast<http_client *>(userptr)->f_share_mutexes[data].unlock();
+}
+
+
+void http_client::release_request(request_t::pointer_t r)
+{
+    if(r->f_easy != nullptr)
+    {
+        curl_easy_cleanup(r->f_easy);
+        r->f_easy = nullptr;
+    }
+    if(r->f_file != nullptr)
+    {
+        fclose(r->f_file);
+        r->f_file = nullptr;
+    }
+    if(r->f_headers != nullptr)
+    {
+        curl_slist_free_all(r->f_headers);
+        r->f_headers = nullptr;
+    }
+}
+
+
+/** \brief Capture the validators of the response.
+ *
+ * The ETag and Last-Modified headers are saved in the request. When a
+ * redirect is followed, a new status line is received and the headers
+ * of the previous response are ignored.
+ */
+std::size_t http_client::header_callback(
+      char * buffer
+    , std::size_t size
+    , std::size_t nitems
+    , void * userdata)
+{
+    request_t * r(static_cast<request_t *>(userdata));
+    std::size_t const length(size * nitems);
+    std::string const line(buffer, length);
+
+    if(line.compare(0, 5, "HTTP/") == 0)
+    {
+        r->f_etag.clear();
+        r->f_last_modified.clear();
+        return length;
+    }
+
+    std::string::size_type const colon(line.find(':'));
+    if(colon != std::string::npos)
+    {
+        std::string const name(snapdev::to_lower(line.substr(0, colon)));
+        if(name == "etag")
+        {
+            r->f_etag = snapdev::trim_string(line.substr(colon + 1));
+        }
+        else if(name == "last-modified")
+        {
+            r->f_last_modified = snapdev::trim_string(line.substr(colon + 1));
+        }
+    }
+
+    return length;
+}
+
+
+std::string http_client::get_validators_filename(std::string const & filename)
+{
+    return filename + ".headers";
+}
+
+
+void http_client::load_validators(request_t::pointer_t r)
+{
+    r->f_etag.clear();
+    r->f_last_modified.clear();
+
+    // the validators are useless if the data is gone
+    //
+    if(access(r->f_cache_filename.c_str(), R_OK) != 0)
+    {
+        return;
+    }
+
+    std::ifstream in(get_validators_filename(r->f_filename));
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.compare(0, 6, "ETag: ") == 0)
+        {
+            r->f_etag = line.substr(6);
+        }
+        else if(line.compare(0, 15, "Last-Modified: ") == 0)
+        {
+            r->f_last_modified = line.substr(15);
+        }
+    }
+}
+
+
+void http_client::save_validators(request_t::pointer_t r)
+{
+    std::string const filename(get_validators_filename(r->f_filename));
+    if(r->f_etag.empty()
+    && r->f_last_modified.empty())
+    {
+        snapdev::NOT_USED(unlink(filename.c_str()));
+        return;
+    }
+
+    std::string const tmp(filename + ".tmp");
+    {
+        std::ofstream out(tmp);
+        if(!r->f_etag.empty())
+        {
+            out << "ETag: " << r->f_etag << '\n';
+        }
+        if(!r->f_last_modified.empty())
+        {
+            out << "Last-Modified: " << r->f_last_modified << '\n';
+        }
+        if(!out)
+        {
+            snapdev::NOT_USED(unlink(tmp.c_str()));
+            return;
+        }
+    }
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        snapdev::NOT_USED(unlink(tmp.c_str()));
+    }
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,206 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    "remote_health.h"
+
+
+// cppthread
+//
+#include    <cppthread/runner.h>
+#include    <cppthread/thread.h>
+
+
+// C++
+//
+#include    <array>
+#include    <deque>
+#include    <functional>
+#include    <map>
+#include    <memory>
+#include    <mutex>
+#include    <string>
+#include    <string_view>
+#include    <vector>
+
+
+// C
+//
+#include    <curl/curl.h>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Download files over HTTP in parallel.
+ *
+ * The HTTP client runs its own thread which drives a curl_multi handle.
+ * All the transfers happen in that one thread so many files can be
+ * downloaded concurrently without blocking one worker thread per file.
+ * The number of simultaneous connections is limited by the
+ * \p max_connections parameter.
+ *
+ * Requests for a URL already being downloaded to the same file are
+ * attached to the existing transfer instead of starting a new one.
+ *
+ * The files are first saved in a temporary file which gets renamed once
+ * the transfer succeeded. This way a cache file is never half written.
+ *
+ * The ETag and Last-Modified headers of each response are saved in a
+ * \<filename>.headers file. The next download of the same file sends
+ * them back (If-None-Match and If-Modified-Since) and when the server
+ * replies with 304, the existing file is kept as is and the result is
+ * RESULT_NOT_MODIFIED.
+ *
+ * All the requests share one connection cache, DNS cache and TLS session
+ * cache (a CURLSH handle) and HTTP/2 is used whenever possible so many
+ * requests to Launchpad get multiplexed over a single connection. The
+ * statistics include the number of transfers which did not require a
+ * new connection (i.e. no DNS, TCP or TLS handshake).
+ *
+ * When a remote_health object is attached, the outcome of each transfer
+ * is reported to it and new requests fail immediately while it says
+ * that launchpad is not available.
+ */
+class http_client
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<http_client>        pointer_t;
+
+    enum class result_t
+    {
+        RESULT_FAILED,
+        RESULT_DOWNLOADED,
+        RESULT_NOT_MODIFIED,
+    };
+
+    typedef std::function<void(result_t result, long response_code)>
+                                                done_t;
+
+    struct statistics_t
+    {
+        std::size_t             f_requests = 0;
+        std::size_t             f_new_connections = 0;
+        std::size_t             f_handshakes_saved = 0;
+    };
+
+                                http_client(std::size_t max_connections);
+                                http_client(http_client const &) = delete;
+    virtual                     ~http_client() override;
+    http_client &               operator = (http_client const &) = delete;
+
+    void                        start();
+    void                        stop();
+    void                        set_remote_health(remote_health::pointer_t health);
+
+    void                        start_download(
+                                      std::string const & url
+                                    , std::string const & filename
+                                    , done_t done = done_t()
+                                    , std::string const & cache_filename = std::string());
+    result_t                    download(
+                                      std::string const & url
+                                    , std::string const & filename
+                                    , std::string const & cache_filename = std::string());
+    void                        start_head(std::string const & url, done_t done);
+    long                        head(std::string const & url);
+    statistics_t                get_statistics() const;
+
+    static std::string_view     get_user_agent();
+
+    // cppthread::runner implementation
+    //
+    virtual void                run() override;
+
+private:
+    struct request_t
+    {
+        typedef std::shared_ptr<request_t>      pointer_t;
+
+        std::string                 f_url = std::string();
+        bool                        f_head = false;
+        std::string                 f_filename = std::string();
+        std::string                 f_cache_filename = std::string();
+        std::string                 f_tmp_filename = std::string();
+        FILE *                      f_file = nullptr;
+        CURL *                      f_easy = nullptr;
+        curl_slist *                f_headers = nullptr;
+        std::string                 f_etag = std::string();
+        std::string                 f_last_modified = std::string();
+        std::vector<done_t>         f_done = std::vector<done_t>();
+    };
+    typedef std::map<std::string, request_t::pointer_t> request_map_t;
+
+    void                        add_request(request_t::pointer_t r, done_t done);
+    static std::string          get_key(request_t::pointer_t r);
+    static bool                 is_server_failure(CURLcode code, long response_code);
+    void                        add_new_requests();
+    bool                        start_request(request_t::pointer_t r);
+    void                        read_done_transfers();
+    void                        setup_easy(request_t::pointer_t r);
+    void                        finish_request(
+                                      request_t::pointer_t r
+                                    , result_t result
+                                    , long response_code);
+    static void                 release_request(request_t::pointer_t r);
+    static std::size_t          header_callback(
+                                      char * buffer
+                                    , std::size_t size
+                                    , std::size_t nitems
+                                    , void * userdata);
+    static std::string          get_validators_filename(std::string const & filename);
+    static void                 load_validators(request_t::pointer_t r);
+    static void                 save_validators(request_t::pointer_t r);
+    static void                 share_lock(
+                                      CURL * handle
+                                    , curl_lock_data data
+                                    , curl_lock_access access
+                                    , void * userptr);
+    static void                 share_unlock(
+                                      CURL * handle
+                                    , curl_lock_data data
+                                    , void * userptr);
+
+    std::size_t                 f_max_connections = 0;
+    CURLM *                     f_multi = nullptr;
+    CURLSH *                    f_share = nullptr;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST>
+                                f_share_mutexes = std::array<std::mutex, CURL_LOCK_DATA_LAST>();
+    cppthread::thread::pointer_t
+                                f_thread = cppthread::thread::pointer_t();
+    std::deque<request_t::pointer_t>
+                                f_new_requests = std::deque<request_t::pointer_t>();
+    request_map_t               f_requests = request_map_t();
+    std::map<CURL *, request_t::pointer_t>
+                                f_transfers = std::map<CURL *, request_t::pointer_t>();
+    statistics_t                f_statistics = statistics_t();
+    remote_health::pointer_t    f_remote_health = remote_health::pointer_t();
+    bool                        f_done = false;
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,263 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "local_probe.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/join_strings.h>
+
+
+// C++
+//
+#include    <deque>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// the probes are all run by the main thread so these globals do not
+// need to be protected by a mutex
+//
+// the number of processes is limited so we do not start hundreds of
+// processes all at once when loading a large tree
+//
+constexpr std::size_t const     g_max_running_processes = 32;
+
+std::size_t                     g_running_processes = 0;
+
+std::deque<std::pair<local_probe::pointer_t, std::size_t>>
+                                g_waiting_commands = std::deque<std::pair<local_probe::pointer_t, std::size_t>>();
+
+// the process & capture objects can't be destroyed from within their
+// own callback, so we keep them here until the next command is done
+//
+std::vector<std::shared_ptr<void>>
+                                g_zombies = std::vector<std::shared_ptr<void>>();
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a probe.
+ *
+ * \param[in] name  The name of the probe (i.e. the project name), used
+ * to name the processes.
+ * \param[in] working_directory  The directory in which the commands run.
+ * \param[in] done  The callback called once all the commands are done.
+ */
+local_probe::local_probe(
+          std::string const & name
+        , std::string const & working_directory
+        , done_t done)
+    : f_name(name)
+    , f_working_directory(working_directory)
+    , f_done(done)
+{
+}
+
+
+/** \brief Add a command to this probe.
+ *
+ * The command is run directly (no shell) in the probe working directory.
+ * Once it exits, its output is sent to the \p output callback. If the
+ * command fails, the output is an empty string.
+ *
+ * \param[in] command  The command to run (i.e. "git").
+ * \param[in] args  The command line arguments.
+ * \param[in] output  The callback receiving the output of the command.
+ */
+void local_probe::add_command(
+      std::string const & command
+    , advgetopt::string_list_t const & args
+    , output_t output)
+{
+    command_t c;
+    c.f_command = command;
+    c.f_args = args;
+    c.f_output = output;
+    f_commands.push_back(c);
+}
+
+
+/** \brief Start the commands.
+ *
+ * The commands are added to the list of waiting commands. They get started
+ * as soon as less than the maximum number of processes are running.
+ */
+void local_probe::start()
+{
+    f_pending = f_commands.size();
+    if(f_pending == 0)
+    {
+        f_done();
+        return;
+    }
+
+    for(std::size_t idx(0); idx < f_commands.size(); ++idx)
+    {
+        g_waiting_commands.push_back(std::make_pair(shared_from_this(), idx));
+    }
+
+    start_next_commands();
+}
+
+
+std::size_t local_probe::get_running_processes()
+{
+    return g_running_processes;
+}
+
+
+void local_probe::start_next_commands()
+{
+    while(g_running_processes < g_max_running_processes
+       && !g_waiting_commands.empty())
+    {
+        auto const next(g_waiting_commands.front());
+        g_waiting_commands.pop_front();
+
+        ++g_running_processes;
+        next.first->start_command(next.second);
+    }
+}
+
+
+void local_probe::start_command(std::size_t idx)
+{
+    command_t & c(f_commands[idx]);
+
+    SNAP_LOG_TRACE
+        << "probe \""
+        << f_name
+        << "\" runs: "
+        << c.f_command
+        << ' '
+        << snapdev::join_strings(c.f_args, " ")
+        << SNAP_LOG_SEND;
+
+    c.f_capture = std::make_shared<cppprocess::io_capture_pipe>();
+    c.f_capture->add_process_done_callback(std::bind(
+                  &local_probe::command_done
+                , shared_from_this()
+                , idx
+                , std::placeholders::_1
+                , std::placeholders::_2));
+
+    c.f_process = std::make_shared<cppprocess::process>(f_name + ':' + c.f_command);
+    c.f_process->set_working_directory(f_working_directory);
+    c.f_process->set_command(c.f_command);
+    for(auto const & a : c.f_args)
+    {
+        c.f_process->add_argument(a);
+    }
+    c.f_process->set_output_io(c.f_capture);
+    if(c.f_process->start() != 0)
+    {
+        SNAP_LOG_ERROR
+            << "probe \""
+            << f_name
+            << "\" could not start command \""
+            << c.f_command
+            << "\"."
+            << SNAP_LOG_SEND;
+
+        --g_running_processes;
+        c.f_process.reset();
+        c.f_capture.reset();
+        command_output(idx, std::string());
+    }
+}
+
+
+bool local_probe::command_done(
+      std::size_t idx
+    , cppprocess::io * output_pipe
+    , cppprocess::done_reason_t reason)
+{
+    g_zombies.clear();
+
+    command_t & c(f_commands[idx]);
+
+    std::string output;
+    if(reason != cppprocess::done_reason_t::DONE_REASON_EOF
+    && reason != cppprocess::done_reason_t::DONE_REASON_HUP)
+    {
+        SNAP_LOG_ERROR
+            << "probe \""
+            << f_name
+            << "\" command \""
+            << c.f_command
+            << "\" failed; reason: "
+            << static_cast<int>(reason)
+            << SNAP_LOG_SEND;
+    }
+    else
+    {
+        cppprocess::io_capture_pipe * capture(dynamic_cast<cppprocess::io_capture_pipe *>(output_pipe));
+        if(capture != nullptr)
+        {
+            output = capture->get_output();
+        }
+    }
+
+    --g_running_processes;
+    g_zombies.push_back(c.f_process);
+    g_zombies.push_back(c.f_capture);
+    c.f_process.reset();
+    c.f_capture.reset();
+
+    command_output(idx, output);
+
+    start_next_commands();
+
+    return true;
+}
+
+
+void local_probe::command_output(std::size_t idx, std::string const & output)
+{
+    f_commands[idx].f_output(output);
+
+    --f_pending;
+    if(f_pending == 0)
+    {
+        f_done();
+    }
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,111 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// advgetopt
+//
+#include    <advgetopt/utils.h>
+
+
+// cppprocess
+//
+#include    <cppprocess/io_capture_pipe.h>
+#include    <cppprocess/process.h>
+
+
+// C++
+//
+#include    <functional>
+#include    <memory>
+#include    <vector>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Run a set of commands asynchronously.
+ *
+ * A local probe is a set of commands run in one working directory (i.e.
+ * a project folder). The commands are run with cppprocess so the main
+ * thread ed::communicator manages them and captures their output. This
+ * means many projects can be probed simultaneously without blocking a
+ * thread per process.
+ *
+ * Each command has a callback which receives its output. Once all the
+ * commands are done, the done callback gets called.
+ *
+ * \warning
+ * The probes must be started and are processed in the main thread.
+ */
+class local_probe
+    : public std::enable_shared_from_this<local_probe>
+{
+public:
+    typedef std::shared_ptr<local_probe>                        pointer_t;
+    typedef std::function<void(std::string const & output)>     output_t;
+    typedef std::function<void()>                               done_t;
+
+                                local_probe(
+                                      std::string const & name
+                                    , std::string const & working_directory
+                                    , done_t done);
+                                local_probe(local_probe const &) = delete;
+    local_probe &               operator = (local_probe const &) = delete;
+
+    void                        add_command(
+                                      std::string const & command
+                                    , advgetopt::string_list_t const & args
+                                    , output_t output);
+    void                        start();
+
+    static std::size_t          get_running_processes();
+
+private:
+    struct command_t
+    {
+        std::string                             f_command = std::string();
+        advgetopt::string_list_t                f_args = advgetopt::string_list_t();
+        output_t                                f_output = output_t();
+        cppprocess::process::pointer_t          f_process = cppprocess::process::pointer_t();
+        cppprocess::io_capture_pipe::pointer_t  f_capture = cppprocess::io_capture_pipe::pointer_t();
+    };
+    typedef std::vector<command_t>      command_vector_t;
+
+    static void                 start_next_commands();
+    void                        start_command(std::size_t idx);
+    bool                        command_done(
+                                      std::size_t idx
+                                    , cppprocess::io * output_pipe
+                                    , cppprocess::done_reason_t reason);
+    void                        command_output(std::size_t idx, std::string const & output);
+
+    std::string                 f_name = std::string();
+    std::string                 f_working_directory = std::string();
+    done_t                      f_done = done_t();
+    command_vector_t            f_commands = command_vector_t();
+    std::size_t                 f_pending = 0;
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
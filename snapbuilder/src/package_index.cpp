@@ -0,0 +1,289 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "package_index.h"
+
+#include    "snap_builder.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/string_replace_many.h>
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#include    <zlib.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// several projects get packaged at the same time, they all share the
+// same indexes so we do not need to download them more often than this
+//
+constexpr time_t const      g_refresh_interval = 60;
+
+
+} // no name namespace
+
+
+
+package_index::package_index(snap_builder * sb)
+    : f_snap_builder(sb)
+{
+}
+
+
+/** \brief Make sure the index of a release and architecture is current.
+ *
+ * This function downloads the Packages.gz file of the specified release
+ * and architecture if it was not downloaded in the last minute. The
+ * download is conditional so if the file did not change, the index
+ * already in memory is kept as is.
+ *
+ * \param[in] codename  The name of the release (i.e. "jammy").
+ * \param[in] arch  The name of the architecture (i.e. "amd64").
+ *
+ * \return true if the index is available.
+ */
+bool package_index::refresh(
+      std::string const & codename
+    , std::string const & arch)
+{
+    std::string const key(codename + ':' + arch);
+    time_t const now(time(nullptr));
+    bool loaded(false);
+    {
+        cppthread::guard lock(f_mutex);
+        index_t const & index(f_indexes[key]);
+        if(index.f_loaded
+        && now - index.f_last_refresh < g_refresh_interval)
+        {
+            return true;
+        }
+        loaded = index.f_loaded;
+    }
+
+    std::string const filename(get_filename(codename, arch));
+    http_client::result_t const result(f_snap_builder->get_http_client()->download(
+              get_url(codename, arch)
+            , filename));
+    if(result == http_client::result_t::RESULT_FAILED)
+    {
+        return false;
+    }
+
+    if(result == http_client::result_t::RESULT_NOT_MODIFIED
+    && loaded)
+    {
+        cppthread::guard lock(f_mutex);
+        f_indexes[key].f_last_refresh = now;
+        return true;
+    }
+
+    versions_t versions;
+    if(!load(filename, versions))
+    {
+        return false;
+    }
+
+    SNAP_LOG_INFO
+        << "indexed "
+        << versions.size()
+        << " packages for \""
+        << key
+        << "\"."
+        << SNAP_LOG_SEND;
+
+    cppthread::guard lock(f_mutex);
+    index_t & index(f_indexes[key]);
+    index.f_versions.swap(versions);
+    index.f_last_refresh = now;
+    index.f_loaded = true;
+
+    return true;
+}
+
+
+/** \brief Check whether a package is available.
+ *
+ * \param[in] codename  The name of the release (i.e. "jammy").
+ * \param[in] arch  The name of the architecture of the index; packages
+ * with architecture "all" are found in all the indexes.
+ * \param[in] package  The name of the binary package.
+ * \param[in] version  The expected version (i.e. "1.1.34.0~jammy").
+ *
+ * \return true if that version of the package is listed in the index.
+ */
+bool package_index::has_package(
+      std::string const & codename
+    , std::string const & arch
+    , std::string const & package
+    , std::string const & version) const
+{
+    cppthread::guard lock(f_mutex);
+
+    auto const index(f_indexes.find(codename + ':' + arch));
+    if(index == f_indexes.end())
+    {
+        return false;
+    }
+
+    auto const versions(index->second.f_versions.find(package));
+    if(versions == index->second.f_versions.end())
+    {
+        return false;
+    }
+
+    return versions->second.find(version) != versions->second.end();
+}
+
+
+std::string package_index::get_url(
+      std::string const & codename
+    , std::string const & arch) const
+{
+    return snapdev::string_replace_many(
+              f_snap_builder->get_packages_url()
+            , {
+                  { "@CODENAME@", codename }
+                , { "@ARCH@", arch }
+              });
+}
+
+
+std::string package_index::get_filename(
+      std::string const & codename
+    , std::string const & arch) const
+{
+    return f_snap_builder->get_cache_path()
+         + "/Packages_"
+         + codename
+         + '_'
+         + arch
+         + ".gz";
+}
+
+
+/** \brief Read the package names and versions from a Packages.gz file.
+ *
+ * The file is decompressed one line at a time. Only the "Package:" and
+ * "Version:" fields are kept. Lines which do not fit in the buffer (i.e.
+ * long descriptions) are skipped.
+ *
+ * \param[in] filename  The name of the compressed file to load.
+ * \param[out] versions  The map where the versions get saved.
+ *
+ * \return true if the whole file was read.
+ */
+bool package_index::load(std::string const & filename, versions_t & versions)
+{
+    std::unique_ptr<gzFile_s, decltype(&::gzclose)> in(gzopen(filename.c_str(), "rb"), &::gzclose);
+    if(in == nullptr)
+    {
+        SNAP_LOG_ERROR
+            << "could not open \""
+            << filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    std::string package;
+    bool line_start(true);
+    char buf[1024];
+    while(gzgets(in.get(), buf, sizeof(buf)) != nullptr)
+    {
+        std::size_t len(strlen(buf));
+        bool const start(line_start);
+        line_start = len > 0 && buf[len - 1] == '\n';
+        if(!start)
+        {
+            // rest of a long line
+            //
+            continue;
+        }
+        if(line_start)
+        {
+            --len;
+            buf[len] = '\0';
+        }
+
+        if(len == 0)
+        {
+            // end of a paragraph
+            //
+            package.clear();
+        }
+        else if(strncmp(buf, "Package: ", 9) == 0)
+        {
+            package = buf + 9;
+        }
+        else if(strncmp(buf, "Version: ", 9) == 0
+             && !package.empty())
+        {
+            versions[package].insert(buf + 9);
+        }
+    }
+
+    if(!gzeof(in.get()))
+    {
+        int errnum(Z_OK);
+        char const * msg(gzerror(in.get(), &errnum));
+        SNAP_LOG_ERROR
+            << "could not decompress \""
+            << filename
+            << "\" ("
+            << msg
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,103 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <ctime>
+#include    <map>
+#include    <memory>
+#include    <set>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+class snap_builder;
+
+
+/** \brief Index of the packages published in the PPA.
+ *
+ * Launchpad publishes one Packages.gz file per release (codename) and
+ * architecture. That file lists all the packages available in the PPA
+ * with their version. Downloading that one file tells us whether the
+ * .deb of all the projects are available, instead of sending one HEAD
+ * request per .deb.
+ *
+ * The files are downloaded conditionally (i.e. a 304 keeps the cached
+ * copy) and decompressed line by line. Only the package names and
+ * versions are kept in memory.
+ *
+ * The index is shared by all the workers.
+ */
+class package_index
+{
+public:
+    typedef std::shared_ptr<package_index>      pointer_t;
+
+                                package_index(snap_builder * sb);
+                                package_index(package_index const &) = delete;
+    package_index &             operator = (package_index const &) = delete;
+
+    bool                        refresh(
+                                      std::string const & codename
+                                    , std::string const & arch);
+    bool                        has_package(
+                                      std::string const & codename
+                                    , std::string const & arch
+                                    , std::string const & package
+                                    , std::string const & version) const;
+
+private:
+    typedef std::map<std::string, std::set<std::string>>    versions_t;
+
+    struct index_t
+    {
+        versions_t              f_versions = versions_t();
+        time_t                  f_last_refresh = 0;
+        bool                    f_loaded = false;
+    };
+    typedef std::map<std::string, index_t>      index_map_t;
+
+    std::string                 get_url(
+                                      std::string const & codename
+                                    , std::string const & arch) const;
+    std::string                 get_filename(
+                                      std::string const & codename
+                                    , std::string const & arch) const;
+    static bool                 load(std::string const & filename, versions_t & versions);
+
+    snap_builder *              f_snap_builder = nullptr;
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    index_map_t                 f_indexes = index_map_t();
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,172 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "pattern_matcher.h"
+
+
+// C++
+//
+#include    <deque>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Add a pattern to search.
+ *
+ * The patterns must all be added before calling compile().
+ *
+ * \param[in] pattern  The pattern, empty patterns are ignored.
+ */
+void pattern_matcher::add_pattern(std::string const & pattern)
+{
+    if(!pattern.empty())
+    {
+        f_patterns.push_back(pattern);
+    }
+}
+
+
+/** \brief Build the automaton.
+ *
+ * First the patterns are added to a trie. Then the failure links get
+ * computed breadth first and folded in the transition table so the
+ * search never has to follow them.
+ */
+void pattern_matcher::compile()
+{
+    f_transitions.clear();
+    f_accept.clear();
+    add_state();
+
+    // build the trie, -1 means "no transition yet"
+    //
+    for(auto const & p : f_patterns)
+    {
+        state_t state(0);
+        for(char const c : p)
+        {
+            std::size_t const idx(state * ALPHABET_SIZE + static_cast<unsigned char>(c));
+            if(f_transitions[idx] < 0)
+            {
+                state_t const next(add_state());
+                f_transitions[state * ALPHABET_SIZE + static_cast<unsigned char>(c)] = next;
+            }
+            state = f_transitions[state * ALPHABET_SIZE + static_cast<unsigned char>(c)];
+        }
+        f_accept[state] = true;
+    }
+
+    // compute the failure links and fill the missing transitions
+    //
+    std::vector<state_t> failure(f_accept.size(), 0);
+    std::deque<state_t> queue;
+    for(std::size_t c(0); c < ALPHABET_SIZE; ++c)
+    {
+        state_t & next(f_transitions[c]);
+        if(next < 0)
+        {
+            next = 0;
+        }
+        else
+        {
+            failure[next] = 0;
+            queue.push_back(next);
+        }
+    }
+    while(!queue.empty())
+    {
+        state_t const state(queue.front());
+        queue.pop_front();
+
+        // a pattern which ends inside another pattern matches as well
+        //
+        if(f_accept[failure[state]])
+        {
+            f_accept[state] = true;
+        }
+
+        for(std::size_t c(0); c < ALPHABET_SIZE; ++c)
+        {
+            state_t & next(f_transitions[state * ALPHABET_SIZE + c]);
+            state_t const fallback(f_transitions[failure[state] * ALPHABET_SIZE + c]);
+            if(next < 0)
+            {
+                next = fallback;
+            }
+            else
+            {
+                failure[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+
+/** \brief Check whether any one of the patterns appears in a string.
+ *
+ * \param[in] s  The string to search.
+ * \param[in] length  The length of \p s in bytes.
+ *
+ * \return true if at least one pattern was found.
+ */
+bool pattern_matcher::match(char const * s, std::size_t length) const
+{
+    if(f_accept.empty())
+    {
+        return false;
+    }
+
+    state_t state(0);
+    for(std::size_t idx(0); idx < length; ++idx)
+    {
+        state = f_transitions[state * ALPHABET_SIZE + static_cast<unsigned char>(s[idx])];
+        if(f_accept[state])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool pattern_matcher::match(std::string const & s) const
+{
+    return match(s.data(), s.length());
+}
+
+
+pattern_matcher::state_t pattern_matcher::add_state()
+{
+    state_t const state(f_accept.size());
+    f_transitions.resize(f_transitions.size() + ALPHABET_SIZE, -1);
+    f_accept.push_back(false);
+    return state;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
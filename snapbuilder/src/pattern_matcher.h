@@ -0,0 +1,65 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <vector>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Search many patterns at once.
+ *
+ * This is an Aho-Corasick automaton compiled to a full transition table
+ * (a DFA). Once compiled, searching a string for all the patterns costs
+ * one table lookup per byte, whatever the number of patterns.
+ *
+ * The patterns are literal strings and the search is case sensitive.
+ */
+class pattern_matcher
+{
+public:
+    void                        add_pattern(std::string const & pattern);
+    void                        compile();
+    bool                        match(char const * s, std::size_t length) const;
+    bool                        match(std::string const & s) const;
+
+private:
+    typedef std::int32_t        state_t;
+
+    static constexpr std::size_t const  ALPHABET_SIZE = 256;
+
+    state_t                     add_state();
+
+    std::vector<std::string>    f_patterns = std::vector<std::string>();
+    std::vector<state_t>        f_transitions = std::vector<state_t>();
+    std::vector<bool>           f_accept = std::vector<bool>();
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,317 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "poll_scheduler.h"
+
+#include    "snap_builder.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <fstream>
+
+
+// C
+//
+#include    <stdio.h>
+#include    <unistd.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// when we do not yet know how long it takes to publish the .deb files
+//
+constexpr time_t const      g_default_publish_duration = 15 * 60;
+
+// the first check once the expected completion time passed and the
+// maximum delay between two checks
+//
+constexpr int const         g_min_delay = 60;
+constexpr int const         g_max_delay = 15 * 60;
+
+// the maximum jitter added to a delay, as a fraction of that delay
+//
+constexpr double const      g_jitter = 0.1;
+
+// minimum number of seconds between two polls
+//
+constexpr time_t const      g_spread = 10;
+
+// a longer publication means snapbuilder was not running at the time
+// so the measurement is ignored
+//
+constexpr time_t const      g_max_publish_duration = 4 * 60 * 60;
+
+// weight of the newest publication duration in the moving average
+//
+constexpr double const      g_weight = 0.3;
+
+
+} // no name namespace
+
+
+
+poll_scheduler::poll_scheduler(snap_builder * sb)
+    : f_snap_builder(sb)
+{
+    load();
+}
+
+
+/** \brief Get the expected duration of the publication of a package.
+ *
+ * Once launchpad is done compiling, it takes a while before the .deb
+ * files get published. This function returns the average of the
+ * durations measured for that project and architecture.
+ *
+ * \param[in] project_name  The name of the project.
+ * \param[in] arch  The architecture (i.e. "amd64").
+ *
+ * \return The expected duration in seconds.
+ */
+time_t poll_scheduler::get_publish_duration(
+      std::string const & project_name
+    , std::string const & arch) const
+{
+    cppthread::guard lock(f_mutex);
+    auto const it(f_publish_durations.find(project_name + '/' + arch));
+    if(it == f_publish_durations.end())
+    {
+        return g_default_publish_duration;
+    }
+    return static_cast<time_t>(it->second);
+}
+
+
+/** \brief Record the time it took to publish a package.
+ *
+ * The duration is added to an exponential moving average so the
+ * expectation follows the current speed of launchpad.
+ *
+ * \param[in] project_name  The name of the project.
+ * \param[in] arch  The architecture (i.e. "amd64").
+ * \param[in] duration  The number of seconds between the end of the
+ * compilation and the moment we found the .deb files.
+ */
+void poll_scheduler::add_publish_duration(
+      std::string const & project_name
+    , std::string const & arch
+    , time_t duration)
+{
+    if(duration <= 0
+    || duration > g_max_publish_duration)
+    {
+        return;
+    }
+
+    {
+        cppthread::guard lock(f_mutex);
+        std::string const key(project_name + '/' + arch);
+        auto it(f_publish_durations.find(key));
+        if(it == f_publish_durations.end())
+        {
+            f_publish_durations[key] = static_cast<double>(duration);
+        }
+        else
+        {
+            it->second = it->second * (1.0 - g_weight) + static_cast<double>(duration) * g_weight;
+        }
+    }
+
+    save();
+}
+
+
+/** \brief Compute the number of seconds until the next check.
+ *
+ * If the \p expected_completion time is still in the future, the check
+ * happens then (at most g_max_delay seconds from now). Otherwise, we
+ * missed it and the delay doubles on each miss, starting at g_min_delay.
+ * A change of the expected completion time (i.e. one architecture is
+ * done, the project switched to packaging) resets the backoff.
+ *
+ * A random jitter of up to 10% gets added and the poll is moved forward
+ * until it is at least g_spread seconds away from the poll of any other
+ * project so the checks do not all happen in a row.
+ *
+ * \param[in] project_name  The project being watched.
+ * \param[in] expected_completion  When we expect the project to be done,
+ * or 0 if unknown.
+ *
+ * \return The number of seconds to wait before checking the project again.
+ */
+int poll_scheduler::next_poll(
+      std::string const & project_name
+    , time_t expected_completion)
+{
+    time_t const now(time(nullptr));
+
+    cppthread::guard lock(f_mutex);
+
+    poll_t & p(f_polls[project_name]);
+    if(p.f_expected_completion != expected_completion)
+    {
+        p.f_expected_completion = expected_completion;
+        p.f_misses = 0;
+    }
+
+    int delay(0);
+    if(expected_completion > now + g_min_delay / 2)
+    {
+        delay = static_cast<int>(std::min(expected_completion - now, static_cast<time_t>(g_max_delay)));
+    }
+    else
+    {
+        delay = std::min(g_min_delay << std::min(p.f_misses, 4), g_max_delay);
+        ++p.f_misses;
+    }
+
+    delay += std::uniform_int_distribution<int>(0, static_cast<int>(delay * g_jitter))(f_random);
+
+    p.f_next_poll = spread(project_name, now + delay);
+
+    SNAP_LOG_DEBUG
+        << "next check of \""
+        << project_name
+        << "\" in "
+        << p.f_next_poll - now
+        << " seconds (misses: "
+        << p.f_misses
+        << ")."
+        << SNAP_LOG_SEND;
+
+    return static_cast<int>(p.f_next_poll - now);
+}
+
+
+/** \brief Forget about a project once it is done building.
+ *
+ * \param[in] project_name  The project which is not being watched anymore.
+ */
+void poll_scheduler::forget(std::string const & project_name)
+{
+    cppthread::guard lock(f_mutex);
+    f_polls.erase(project_name);
+}
+
+
+/** \brief Move a poll away from the other polls.
+ *
+ * \warning
+ * The mutex must be locked by the caller.
+ *
+ * \param[in] project_name  The project being scheduled.
+ * \param[in] when  The time we would like to check that project.
+ *
+ * \return The time at which the project gets checked.
+ */
+time_t poll_scheduler::spread(std::string const & project_name, time_t when) const
+{
+    for(bool moved(true); moved; )
+    {
+        moved = false;
+        for(auto const & p : f_polls)
+        {
+            if(p.first != project_name
+            && p.second.f_next_poll + g_spread > when
+            && p.second.f_next_poll < when + g_spread)
+            {
+                when = p.second.f_next_poll + g_spread;
+                moved = true;
+            }
+        }
+    }
+    return when;
+}
+
+
+std::string poll_scheduler::get_filename() const
+{
+    return f_snap_builder->get_cache_path() + "/publish_durations";
+}
+
+
+void poll_scheduler::load()
+{
+    std::ifstream in(get_filename());
+    std::string key;
+    double duration(0.0);
+    while(in >> key >> duration)
+    {
+        if(duration > 0.0)
+        {
+            f_publish_durations[key] = duration;
+        }
+    }
+}
+
+
+void poll_scheduler::save() const
+{
+    std::string const filename(get_filename());
+    std::string const tmp(filename + ".tmp");
+
+    // the temporary file is shared, so the lock has to cover everything
+    // from the open to the rename
+    //
+    cppthread::guard lock(f_mutex);
+    {
+        std::ofstream out(tmp);
+        for(auto const & d : f_publish_durations)
+        {
+            out << d.first << ' ' << static_cast<time_t>(d.second) << '\n';
+        }
+        if(!out)
+        {
+            SNAP_LOG_ERROR
+                << "could not save the publish durations to \""
+                << tmp
+                << "\"."
+                << SNAP_LOG_SEND;
+            unlink(tmp.c_str());
+            return;
+        }
+    }
+    rename(tmp.c_str(), filename.c_str());
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
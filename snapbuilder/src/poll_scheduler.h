@@ -0,0 +1,109 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <ctime>
+#include    <map>
+#include    <memory>
+#include    <random>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+class snap_builder;
+
+
+/** \brief Decide when the next check of a build happens.
+ *
+ * Instead of checking each building project every minute, the watch
+ * jobs ask the scheduler when to check again. The project computes
+ * when it expects its build to complete from the durations of its
+ * previous builds (compiling) and from the durations we measured
+ * between the end of the compilation and the publication of the .deb
+ * files (packaging). The scheduler then:
+ *
+ * \li waits until the expected completion time;
+ * \li if the build is not done by then, backs off exponentially;
+ * \li adds a little jitter and moves the poll so it does not happen
+ *     at the same time as the poll of another project.
+ *
+ * The publication durations are saved in the cache so they survive a
+ * restart. The compilation durations are already part of the build
+ * records.
+ */
+class poll_scheduler
+{
+public:
+    typedef std::shared_ptr<poll_scheduler>     pointer_t;
+
+                                poll_scheduler(snap_builder * sb);
+                                poll_scheduler(poll_scheduler const &) = delete;
+    poll_scheduler &            operator = (poll_scheduler const &) = delete;
+
+    time_t                      get_publish_duration(
+                                      std::string const & project_name
+                                    , std::string const & arch) const;
+    void                        add_publish_duration(
+                                      std::string const & project_name
+                                    , std::string const & arch
+                                    , time_t duration);
+    int                         next_poll(
+                                      std::string const & project_name
+                                    , time_t expected_completion);
+    void                        forget(std::string const & project_name);
+
+private:
+    typedef std::map<std::string, double>       durations_t;
+
+    struct poll_t
+    {
+        time_t                  f_expected_completion = 0;
+        int                     f_misses = 0;
+        time_t                  f_next_poll = 0;
+    };
+    typedef std::map<std::string, poll_t>       poll_map_t;
+
+    std::string                 get_filename() const;
+    void                        load();
+    void                        save() const;
+    time_t                      spread(std::string const & project_name, time_t when) const;
+
+    snap_builder *              f_snap_builder = nullptr;
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    durations_t                 f_publish_durations = durations_t();
+    poll_map_t                  f_polls = poll_map_t();
+    std::mt19937                f_random = std::mt19937(std::random_device()());
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
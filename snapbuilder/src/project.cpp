@@ -21,8 +21,11 @@
 //
 #include    "project.h"
 
+#include    "changelog.h"
+#include    "package_index.h"
+#include    "poll_scheduler.h"
+#include    "remote_info_store.h"
 #include    "snap_builder.h"
-#include    "version.h"
 
 
 // cppprocess
@@ -31,11 +34,6 @@
 #include    <cppprocess/io_data_pipe.h>
 
 
-// as2js
-//
-#include    <as2js/json.h>
-
-
 // cppthread
 //
 #include    <cppthread/guard.h>
@@ -67,7 +65,7 @@
 
 // C
 //
-#include    <curl/curl.h>
+#include    <dirent.h>
 #include    <sys/stat.h>
 
 
@@ -90,42 +88,6 @@ namespace
 cppprocess::process::pointer_t  g_dot_process = cppprocess::process::pointer_t();
 
 
-constexpr std::string_view  g_user_agent_name = "snapbuilder";
-constexpr std::string_view  g_user_agent_version = SNAPBUILDER_VERSION_STRING;
-constexpr std::string_view  g_user_agent_platform = "Linux; Ubuntu; x86_64";
-constexpr std::string_view  g_user_agent_curl = "curl/8.5.0+";
-constexpr std::string_view  g_user_agent_wget = "wget/1.21.4+";
-
-constexpr std::string_view  g_user_agent_space = " ";
-constexpr std::string_view  g_user_agent_separator = "/";
-constexpr std::string_view  g_user_agent_open_parenthesis = "(";
-constexpr std::string_view  g_user_agent_close_parenthesis = ")";
-
-constexpr std::string_view  g_curl_user_agent =
-    snapdev::join_string_views<
-        g_user_agent_name,
-        g_user_agent_separator,
-        g_user_agent_version,
-        g_user_agent_space,
-        g_user_agent_open_parenthesis,
-        g_user_agent_platform,
-        g_user_agent_close_parenthesis,
-        g_user_agent_space,
-        g_user_agent_curl>;
-
-constexpr std::string_view  g_wget_user_agent =
-    snapdev::join_string_views<
-        g_user_agent_name,
-        g_user_agent_separator,
-        g_user_agent_version,
-        g_user_agent_space,
-        g_user_agent_open_parenthesis,
-        g_user_agent_platform,
-        g_user_agent_close_parenthesis,
-        g_user_agent_space,
-        g_user_agent_wget>;
-
-
 
 } // no name namespace
 
@@ -281,9 +243,158 @@ void project::find_project()
 }
 
 
+/** \brief Tell the interface that this project changed.
+ *
+ * The jobs call this function after each pass, whether or not something
+ * changed. To avoid redrawing the row (and regenerating the SVG graph)
+ * for nothing, the signal is only sent when at least one of the values
+ * shown in the table changed.
+ */
 void project::project_changed()
 {
-    f_snap_builder->project_changed(shared_from_this());
+    column_mask_t const columns(update_display_fingerprint());
+    if(columns == 0)
+    {
+        return;
+    }
+
+    f_snap_builder->project_changed(shared_from_this(), columns);
+}
+
+
+/** \brief Compare the displayed values against the last ones sent.
+ *
+ * The fingerprint is a hash of each value shown in the table plus the
+ * state color. The function saves the new fingerprint and returns the
+ * mask of the columns that differ. The first call returns all the
+ * columns.
+ *
+ * \return The mask of the columns which changed, 0 if none.
+ */
+column_mask_t project::update_display_fingerprint()
+{
+    std::hash<std::string> const hash;
+    std::vector<std::size_t> fingerprint(COLUMN_max + 1);
+    fingerprint[COLUMN_CURRENT_VERSION] = hash(get_version());
+    fingerprint[COLUMN_LAUNCHPAD_VERSION] = hash(get_remote_version());
+    fingerprint[COLUMN_CHANGES] = hash(get_state());
+    fingerprint[COLUMN_LOCAL_CHANGES_DATE] = hash(get_last_commit_as_string());
+    fingerprint[COLUMN_BUILD_STATE] = hash(get_remote_build_state() + '\n' + get_build_log_excerpt());
+    fingerprint[COLUMN_LAUNCHPAD_COMPILED_DATE] = hash(get_remote_build_date());
+    fingerprint[COLUMN_max] = get_state_color().rgba();
+
+    guard_project;
+    if(f_display_fingerprint.size() != fingerprint.size())
+    {
+        f_display_fingerprint.swap(fingerprint);
+        return COLUMN_MASK_ALL;
+    }
+
+    column_mask_t columns(0);
+    for(std::size_t idx(0); idx < fingerprint.size(); ++idx)
+    {
+        if(fingerprint[idx] != f_display_fingerprint[idx])
+        {
+            columns |= 1U << idx;
+        }
+    }
+    f_display_fingerprint.swap(fingerprint);
+    return columns;
+}
+
+
+/** \brief Start the local probes of this project.
+ *
+ * This function runs the git commands used to determine the local
+ * state of the project (committed, pushed, last commit timestamp and
+ * hash) asynchronously. The git state is collected with just two
+ * commands, see the repository_status class for details. Since they
+ * are run using cppprocess, all the projects can be probed at once
+ * without blocking a worker thread per command.
+ *
+ * Once all the commands are done, the results are saved in the project
+ * and the \p done callback gets called. At that point, the load_project()
+ * function can be called and it will skip those commands.
+ *
+ * \warning
+ * This function must be called from the main thread.
+ *
+ * \param[in] done  The callback to call once the probes are done.
+ */
+void project::start_local_probes(local_probe::done_t done)
+{
+    if(!f_exists)
+    {
+        done();
+        return;
+    }
+
+    // the fingerprint must be computed before the probes run, if a file
+    // changes while they run, the next load will see a different one
+    //
+    {
+        std::string const fingerprint(get_local_fingerprint());
+        guard_project;
+        f_fingerprint = fingerprint;
+    }
+
+    pointer_t me(shared_from_this());
+    std::shared_ptr<local_probe_output_t> output(std::make_shared<local_probe_output_t>());
+
+    local_probe::pointer_t probe(std::make_shared<local_probe>(
+              f_name
+            , f_project_path
+            , [me, output, done]()
+            {
+                me->local_probes_done(*output);
+                done();
+            }));
+
+    // with libgit2 the repository is inspected directly by the worker
+    // thread, no need for any git process
+    //
+    if(!repository_inspector::get_instance()->is_in_process())
+    {
+        probe->add_command(
+                  "git"
+                , { "--no-optional-locks", "status", "--porcelain=v2", "--branch", "--untracked-files=no" }
+                , [output](std::string const & o) { output->f_status = o; });
+        probe->add_command(
+                  "git"
+                , { "log", "-1", "--format=%H%x00%ct" }
+                , [output](std::string const & o) { output->f_last_commit = o; });
+    }
+
+    probe->start();
+}
+
+
+void project::local_probes_done(local_probe_output_t const & output)
+{
+    if(output.f_status.empty())
+    {
+        return;
+    }
+
+    repository_status status;
+    status.parse_porcelain(output.f_status);
+    status.parse_last_commit(output.f_last_commit);
+    set_state(status.get_state());
+
+    SNAP_LOG_TRACE
+        << "probed project \""
+        << f_name
+        << "\": last commit "
+        << status.get_last_commit_hash()
+        << ", "
+        << status.get_changes()
+        << " changes"
+        << SNAP_LOG_SEND;
+
+    guard_project;
+    f_last_commit = status.get_last_commit();
+    f_last_commit_hash = status.get_last_commit_hash();
+    f_repository_probed = true;
 }
 
 
@@ -297,14 +408,38 @@ void project::load_project()
 
     must_be_background_thread();
 
-    if(!retrieve_version())
+    // if the local probes already ran, we can skip the git commands
+    //
+    bool repository_probed(false);
+    bool cached(false);
+    std::string fingerprint;
     {
-        return;
+        guard_project;
+        repository_probed = f_repository_probed;
+        cached = f_local_state_cached;
+        fingerprint = f_fingerprint;
+        f_repository_probed = false;
+        f_local_state_cached = false;
+        f_fingerprint.clear();
     }
 
-    if(!check_state())
+    if(!cached)
     {
-        return;
+        if(!repository_probed)
+        {
+            fingerprint = get_local_fingerprint();
+        }
+
+        if(!retrieve_version())
+        {
+            return;
+        }
+
+        if(!repository_probed
+        && !check_state())
+        {
+            return;
+        }
     }
 
     // at this point we know about the other states
@@ -314,14 +449,20 @@ void project::load_project()
         f_loaded = true;
     }
 
-    if(!get_last_commit_timestamp())
+    // the state, last commit timestamp & hash were all retrieved at once
+    //
     {
-        return;
+        guard_project;
+        if(f_last_commit <= 0
+        || f_last_commit_hash.empty())
+        {
+            return;
+        }
     }
 
-    if(!get_last_commit_hash())
+    if(!cached)
     {
-        return;
+        save_local_state(fingerprint);
     }
 
     if(!get_build_hash())
@@ -342,25 +483,17 @@ void project::load_project()
 
 bool project::retrieve_version()
 {
-    std::string cmd("cd ");
-    cmd += f_project_path;
-    cmd += "; dpkg-parsechangelog --show-field Version";
-
-    SNAP_LOG_TRACE
-        << "retrieve version with: "
-        << cmd
-        << SNAP_LOG_SEND;
-
-    FILE * p(popen(cmd.c_str(), "r"));
-    char buf[256];
-    if(fgets(buf, sizeof(buf) - 1, p) == nullptr)
+    changelog c;
+    if(!c.read(f_project_path + "/debian/changelog"))
     {
-        buf[0] = '\0';
+        SNAP_LOG_ERROR
+            << c.get_error()
+            << SNAP_LOG_SEND;
+        set_version(std::string());
+        return false;
     }
-    buf[sizeof(buf) - 1] = '\0';
-    pclose(p);
-    std::string version(buf);
 
+    std::string version(c.get_version());
     std::string::size_type tilde(version.find('~'));
     if(tilde != std::string::npos)
     {
@@ -378,145 +511,68 @@ bool project::retrieve_version()
 }
 
 
-bool project::check_state()
-{
-    // verify that we committed
-    //
-    {
-        std::string cmd("cd ");
-        cmd += f_project_path;
-        cmd += "; git diff-index --quiet HEAD --";
-
-        //SNAP_LOG_INFO
-        //    << "verify committed with: "
-        //    << cmd
-        //    << SNAP_LOG_SEND;
-
-        int const r(system(cmd.c_str()));
-        if(r != 0)
-        {
-            set_state("not committed");
-            return true;
-        }
-    }
-
-    // verify that we pushed
-    //
-    {
-        std::string cmd("cd ");
-        cmd += f_project_path;
-        cmd += "; test \"`git rev-parse @{u}`\" = \"`git rev-parse HEAD`\"";
-
-        //SNAP_LOG_INFO
-        //    << "verify pushed with: "
-        //    << cmd
-        //    << SNAP_LOG_SEND;
-
-        int const r(system(cmd.c_str()));
-        if(r != 0)
-        {
-            set_state("not pushed");
-            return true;
-        }
-    }
-
-    // state looks good so far
-    //
-    set_state("ready");
-    return true;
-}
-
-
-bool project::get_last_commit_timestamp()
+/** \brief Inspect the project repository.
+ *
+ * This function uses the repository inspector (libgit2 or git commands)
+ * to retrieve the committed & pushed state, the hash and the timestamp
+ * of the last commit all at once.
+ *
+ * \return true if the last commit hash and timestamp were found.
+ */
+bool project::inspect_repository()
 {
-    std::string cmd("cd ");
-    cmd += f_project_path;
-    cmd += "; git log -1 --format=%ct";
+    repository_status status;
+    bool const valid(repository_inspector::get_instance()->inspect(f_project_path, status));
 
     SNAP_LOG_TRACE
-        << "get last commit timestamp with: "
-        << cmd
+        << "inspected project \""
+        << f_name
+        << "\": last commit "
+        << status.get_last_commit_hash()
+        << ", "
+        << status.get_changes()
+        << " changes"
         << SNAP_LOG_SEND;
 
-    FILE * p(popen(cmd.c_str(), "r"));
-    char buf[256];
-    if(fgets(buf, sizeof(buf) - 1, p) == nullptr)
-    {
-        buf[0] = '\0';
-    }
-    buf[sizeof(buf) - 1] = '\0';
-    pclose(p);
-
-    time_t const last_commit(atol(buf));
-
-    SNAP_LOG_TRACE
-        << "last commit timestamp: "
-        << last_commit
-        << SNAP_LOG_SEND;
+    set_state(status.get_state());
 
     guard_project;
-    f_last_commit = last_commit;
-    return f_last_commit > 0;
+    f_last_commit = status.get_last_commit();
+    f_last_commit_hash = status.get_last_commit_hash();
+    return valid;
 }
 
 
-bool project::get_last_commit_hash()
+bool project::check_state()
 {
-// Using a process would be great but this is asynchronous and at this
-// point I just don't want to deal with 100% asynchronous functionality
-// (i.e. I would then have to read the list of processes and then gather
-// their data; as the data arrives, we could then update the table the
-// user sees, it will be great, but this is just a quick builder helper
-// not an end user project)
-//
-//    // retrieve the hash of our latest `git commit ...` so it can be
-//    // compared against the last build hash
-//    //
-//    {
-//        cppprocess::io_capture_pipe::pointer_t capture(std::make_shared<cppprocess::io_capture_pipe>());
-//        capture->add_process_done_callback(std::bind(&project::last_commit, this));
-//
-//        -- this is the process definition from the header
-//        cppprocess::process::pointer_t
-//                                f_last_commit_process = cppprocess::process::pointer_t();
-//
-//        f_last_commit_process = std::make_shared<cppprocess::process>("last-commit");
-//        f_last_commit_process->set_working_directory(f_project_path);
-//        f_last_commit_process->set_command("git");
-//        f_last_commit_process->add_argument("rev-parse");
-//        f_last_commit_process->add_argument("HEAD");
-//        f_last_commit_process->set_output_io(capture);
-//        f_last_commit_process->start(); // TODO: check return value for errors
-//    }
-
-    std::string cmd("cd ");
-    cmd += f_project_path;
-    cmd += "; git rev-parse HEAD";
+    // the state is always set, even if the last commit could not be read
+    //
+    inspect_repository();
+    return true;
+}
 
-    SNAP_LOG_TRACE
-        << "get last commit hash with: "
-        << cmd
-        << SNAP_LOG_SEND;
 
-    FILE * p(popen(cmd.c_str(), "r"));
-    char buf[256];
-    if(fgets(buf, sizeof(buf) - 1, p) == nullptr)
+/** \brief Refresh the last commit hash and timestamp.
+ *
+ * Contrary to inspect_repository(), this function does not change the
+ * state of the project. It is used while sending a build, when the
+ * state shown to the user must remain "sending".
+ *
+ * \return true if the last commit hash was found.
+ */
+bool project::get_last_commit_hash()
+{
+    repository_status status;
+    repository_inspector::get_instance()->inspect(f_project_path, status);
+    if(status.get_last_commit_hash().empty())
     {
-        buf[0] = '\0';
+        return false;
     }
-    buf[sizeof(buf) - 1] = '\0';
-    pclose(p);
-
-    std::string const last_commit_hash(snapdev::trim_string(std::string(buf)));
-
-    SNAP_LOG_TRACE
-        << "last commit hash: "
-        << f_last_commit_hash
-        << SNAP_LOG_SEND;
 
     guard_project;
-    f_last_commit_hash = last_commit_hash;
-    return !f_last_commit_hash.empty();
+    f_last_commit = status.get_last_commit();
+    f_last_commit_hash = status.get_last_commit_hash();
+    return true;
 }
 
 
@@ -628,6 +684,12 @@ std::string project::get_project_name() const
 }
 
 
+std::string const & project::get_project_path() const
+{
+    return f_project_path;
+}
+
+
 void project::set_version(std::string const & version)
 {
     guard_project;
@@ -815,6 +877,15 @@ std::string project::get_remote_build_state() const
         return std::string("-");
     }
 
+    if(f_building == building_t::BUILDING_PACKAGING
+    && f_debs_total > 0)
+    {
+        return std::to_string(f_debs_available)
+             + '/'
+             + std::to_string(f_debs_total)
+             + " .deb available";
+    }
+
     return f_remote_info[0]->get_build_state();
 }
 
@@ -867,12 +938,13 @@ void project::load_remote_data(bool loading)
     || get_building() == building_t::BUILDING_COMPILING
     || f_list_of_codenames_and_archs.empty())
     {
-        std::string const cache_filename(get_ppa_json_filename());
-        if(access(cache_filename.c_str(), R_OK) != 0)
+        std::string const cache_filename(get_remote_info_filename());
+        if(access(cache_filename.c_str(), R_OK) != 0
+        && !update_remote_info_store())
         {
             // no cache available, load it for the first time
             //
-            if(!retrieve_ppa_status())
+            if(retrieve_ppa_status() == http_client::result_t::RESULT_FAILED)
             {
                 // load failed, that's it for now on that one...
                 //
@@ -890,377 +962,418 @@ void project::load_remote_data(bool loading)
             }
         }
 
-        // read the file and save the few fields we're interested in:
+        // the store has the few fields we're interested in:
         //
         //   - last build date
         //   - build state
         //   - source version
         //   - architecture
         //
-        std::string json_filename(cache_filename);
-        as2js::json json;
-        as2js::json::json_value::pointer_t root(json.load(json_filename));
-        if(root == nullptr)
+        build_record::vector_t records;
+        remote_info_store store;
+        if(!store.open(cache_filename))
         {
-            SNAP_LOG_ERROR
-                << "file \""
-                << cache_filename
-                << "\" does not represent a valid JSON file. Deleting."
-                << SNAP_LOG_SEND;
+            // an older format or an invalid file, download the data again
+            //
             unlink(cache_filename.c_str());
-            return;
+            if(retrieve_ppa_status() == http_client::result_t::RESULT_FAILED
+            || !store.open(cache_filename))
+            {
+                return;
+            }
+        }
+        store.get_records(records);
+        store.close();
+        f_build_records.swap(records);
+
+        apply_build_records();
+    }
+
+    verify_packages(loading);
+}
+
+
+/** \brief Load the remote data from the PPA-wide sweep.
+ *
+ * This function is used instead of retrieve_ppa_status() followed by
+ * load_remote_data() when the sweep is enabled. The records of this
+ * project found by the sweep get merged with the ones we already have.
+ *
+ * \param[in] sweep  The sweep shared by all the projects.
+ *
+ * \return RESULT_FAILED if the sweep failed, RESULT_NOT_MODIFIED if no
+ * record of this project changed, RESULT_DOWNLOADED otherwise.
+ */
+http_client::result_t project::sweep_remote_data(build_sweep::pointer_t sweep)
+{
+    must_be_background_thread();
+
+    sweep->watch(get_project_name(), get_oldest_pending_date());
+    if(!sweep->sweep())
+    {
+        return http_client::result_t::RESULT_FAILED;
+    }
+
+    bool const changed(merge_build_records(sweep->take_records(get_project_name())));
+    if(changed)
+    {
+        // in sweep mode update_remote_info_store() does not get called
+        // so the sweep must keep the store current or the next start
+        // would show the records we had before this build
+        //
+        remote_info_store::save(get_remote_info_filename(), f_build_records);
+    }
+    if(changed
+    && (get_building() == building_t::BUILDING_COMPILING
+        || f_list_of_codenames_and_archs.empty()))
+    {
+        apply_build_records();
+    }
+
+    verify_packages(false);
+
+    if(!is_building())
+    {
+        sweep->unwatch(get_project_name());
+    }
+
+    return changed
+            ? http_client::result_t::RESULT_DOWNLOADED
+            : http_client::result_t::RESULT_NOT_MODIFIED;
+}
+
+
+/** \brief Merge new build records with the existing ones.
+ *
+ * A record with the same self link as an existing record replaces it.
+ * The result is sorted from the newest to the oldest record.
+ *
+ * \param[in] records  The new records.
+ *
+ * \return true if at least one record was added or changed.
+ */
+bool project::merge_build_records(build_record::vector_t const & records)
+{
+    bool changed(false);
+    for(auto const & r : records)
+    {
+        auto it(std::find_if(
+                  f_build_records.begin()
+                , f_build_records.end()
+                , [&r](build_record const & b)
+                {
+                    return b.f_self_link == r.f_self_link;
+                }));
+        if(it == f_build_records.end())
+        {
+            f_build_records.push_back(r);
+            changed = true;
         }
-        if(root->get_type() != as2js::json::json_value::type_t::JSON_TYPE_OBJECT)
+        else if(it->f_buildstate != r.f_buildstate
+             || it->f_datebuilt != r.f_datebuilt
+             || it->f_date_started != r.f_date_started)
         {
-            SNAP_LOG_ERROR
-                << "JSON found in cache file \""
-                << cache_filename
-                << "\" does not represent an object."
-                << SNAP_LOG_SEND;
-            return;
+            *it = r;
+            changed = true;
         }
+    }
+
+    if(changed)
+    {
+        std::stable_sort(
+                  f_build_records.begin()
+                , f_build_records.end()
+                , [](build_record const & a, build_record const & b)
+                {
+                    return a.f_datecreated > b.f_datecreated;
+                });
+    }
 
-        as2js::json::json_value::object_t const & top_fields(root->get_object());
+    return changed;
+}
 
-        // TODO: verify that the "start" field is 0
 
-        auto const it(top_fields.find("entries"));
-        if(it == top_fields.cend())
+/** \brief Get the date from which the sweep has to read the records.
+ *
+ * This is the creation date of the oldest build which is not yet done.
+ * If all the builds are done, this is the date of the newest build
+ * since only newer builds can be of interest.
+ *
+ * \return The date or an empty string if we have no records.
+ */
+std::string project::get_oldest_pending_date() const
+{
+    std::string since;
+    std::string newest;
+    for(auto const & r : f_build_records)
+    {
+        if(!r.is_final()
+        && (since.empty() || r.f_datecreated < since))
         {
-            if(top_fields.find("total_size") != top_fields.end())
-            {
-                // if not empty, we have a "total_size_link" instead
-                //
-                // this happens whenever we create a new project and we have not
-                // yet compiled it on launchpad
-                //
-                SNAP_LOG_ERROR
-                    << "JSON found in cache file \""
-                    << cache_filename
-                    << "\" has a \"total_size\" field which means it is empty."
-                    << SNAP_LOG_SEND;
-                return;
-            }
+            since = r.f_datecreated;
+        }
+        if(r.f_datecreated > newest)
+        {
+            newest = r.f_datecreated;
+        }
+    }
+
+    return since.empty() ? newest : since;
+}
+
+
+/** \brief Apply the build records to this project.
+ *
+ * This function goes through the build records (f_build_records) and
+ * determines the remote version, the build status, and whether the
+ * compilation is done.
+ *
+ * The records are expected to be sorted from the newest to the oldest.
+ */
+void project::apply_build_records()
+{
+    std::set<std::string> built_list_of_codenames_and_archs;
+    f_list_of_codenames_and_archs.clear();
+    set_build_status(build_status_t::BUILD_STATUS_UNKNOWN);
 
+    clear_remote_info(f_build_records.size());
+    for(build_record const & build : f_build_records)
+    {
+        // verify that the project name matches this entry, if not, we
+        // may need to delete the cache...
+        //
+        if(build.f_source_package_name.empty())
+        {
             SNAP_LOG_ERROR
-                << "JSON found in cache file \""
-                << cache_filename
-                << "\" has no \"entries\" field."
+                << "\"source_package_name\" field not found."
                 << SNAP_LOG_SEND;
-            return;
+            continue;
         }
-
-        if(it->second->get_type() != as2js::json::json_value::type_t::JSON_TYPE_ARRAY)
+        if(build.f_source_package_name != get_project_name())
         {
-            SNAP_LOG_ERROR
-                << "JSON found in cache file \""
-                << cache_filename
-                << "\" has an \"entries\" field, but it is not an array."
+            SNAP_LOG_WARNING
+                << "\"source_package_name\" says \""
+                << build.f_source_package_name
+                << "\", we expected \""
+                << get_project_name()
+                << "\" instead (this happens if you changed the name of the project and there are old references in the JSON file from launchpad)."
                 << SNAP_LOG_SEND;
-            return;
+            continue;
         }
 
-        std::set<std::string> built_list_of_codenames_and_archs;
-        f_list_of_codenames_and_archs.clear();
-        set_build_status(build_status_t::BUILD_STATUS_UNKNOWN);
-
-        as2js::json::json_value::array_t const & entries(it->second->get_array());
-        clear_remote_info(entries.size());
-        for(as2js::json::json_value::pointer_t const & e : entries)
-        {
-            // just in case, verify that the entry is an object, if not, just
-            // ignore that item
-            //
-            if(e->get_type() != as2js::json::json_value::type_t::JSON_TYPE_OBJECT)
-            {
-                continue;
-            }
-            as2js::json::json_value::object_t build(e->get_object());
+        // get the creation date
+        //
+        // date when it was last built, we keep that one!
+        //
+        // TODO: get duration
+        //
+        std::string date(build.f_datebuilt);
+        if(date.empty())
+        {
+            date = build.f_date_started;
+        }
+        if(date.empty())
+        {
+            date = build.f_datecreated;
+        }
+        if(date.empty())
+        {
+            SNAP_LOG_WARNING
+                << "no date found in this entry."
+                << SNAP_LOG_SEND;
+        }
 
-            // verify that the project name matches this entry, if not, we
-            // may need to delete the cache...
-            //
-            auto const source_package_name_it(build.find("source_package_name"));
-            if(source_package_name_it == build.end())
-            {
-                SNAP_LOG_ERROR
-                    << "\"source_package_name\" field not found."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
-            if(source_package_name_it->second->get_type() != as2js::json::json_value::type_t::JSON_TYPE_STRING)
-            {
-                SNAP_LOG_ERROR
-                    << "\"source_package_name\" is not a string."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
-            if(source_package_name_it->second->get_string() != get_project_name())
-            {
-                SNAP_LOG_WARNING
-                    << "\"source_package_name\" says \""
-                    << source_package_name_it->second->get_string()
-                    << "\", we expected \""
-                    << get_project_name()
-                    << "\" instead (this happens if you changed the name of the project and there are old references in the JSON file from launchpad)."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
+        // get the build version
+        //
+        std::string build_version(build.f_source_package_version);
+        if(build_version.empty())
+        {
+            SNAP_LOG_ERROR
+                << "no version found in this entry."
+                << SNAP_LOG_SEND;
+            continue;
+        }
 
-            // get the creation date
-            //
-            std::string date;
-            auto const date_built_it(build.find("datebuilt"));
-            if(date_built_it != build.end())
-            {
-                // date when it was last built, we keep that one!
-                //
-                if(date_built_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                {
-                    date = date_built_it->second->get_string();
-                }
+        // the version includes a codename (i.e. "....~bionic")
+        // here we want to break that up so we have a version
+        // and a seperated codename
+        //
+        std::string::size_type const pos(build_version.find('~'));
+        if(pos == std::string::npos)
+        {
+            SNAP_LOG_ERROR
+                << "no '~' found in the version, we expected a codename."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+        std::string const build_codename(build_version.substr(pos + 1));
+        build_version.erase(pos);
 
-                // TODO: get duration
-            }
-            if(date.empty())
-            {
-                auto const date_started_it(build.find("date_started"));
-                if(date_started_it != build.end())
-                {
-                    // date when it was last built, we keep that one!
-                    //
-                    if(date_started_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                    {
-                        date = date_started_it->second->get_string();
-                    }
-                }
-            }
-            if(date.empty())
-            {
-                auto const date_started_it(build.find("datecreated"));
-                if(date_started_it != build.end())
-                {
-                    // date when it was last built, we keep that one!
-                    //
-                    if(date_started_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                    {
-                        date = date_started_it->second->get_string();
-                    }
-                }
-            }
-            if(date.empty())
-            {
-                SNAP_LOG_WARNING
-                    << "no date found in this entry."
-                    << SNAP_LOG_SEND;
-            }
+        // get the build architecture
+        //
+        std::string const & build_arch(build.f_arch_tag);
+        if(build_arch.empty())
+        {
+            SNAP_LOG_ERROR
+                << "no architecture specified in this entry."
+                << SNAP_LOG_SEND;
+            continue;
+        }
 
-            // get the build version
-            //
-            std::string build_version;
-            auto const build_version_it(build.find("source_package_version"));
-            if(build_version_it != build.end())
-            {
-                if(build_version_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                {
-                    build_version = build_version_it->second->get_string();
-                }
-            }
-            if(build_version.empty())
-            {
-                SNAP_LOG_ERROR
-                    << "no version found in this entry."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
+        // to know whether all the versions and architectures are built
+        // we need a complete list of those for our given version
+        //
+        // TODO: this is flaky because it may take a moment for the
+        //       remote system to enter all the data; the poll_scheduler
+        //       re-reads the state at the expected completion time of
+        //       the build and then every 1 to 15 min. so the next checks
+        //       should catch up... assuming no huge delay on launchpad
+        //
+        if(build_version == get_version())
+        {
+            f_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
+        }
 
-            // the version includes a codename (i.e. "....~bionic")
-            // here we want to break that up so we have a version
-            // and a seperated codename
-            //
-            std::string::size_type const pos(build_version.find('~'));
-            if(pos == std::string::npos)
-            {
-                SNAP_LOG_ERROR
-                    << "no '~' found in the version, we expected a codename."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
-            std::string const build_codename(build_version.substr(pos + 1));
-            build_version.erase(pos);
+        // get the build state of this entry
+        //
+        std::string const & build_state(build.f_buildstate);
+        if(build_state.empty())
+        {
+            SNAP_LOG_ERROR
+                << "no build state found in this entry."
+                << SNAP_LOG_SEND;
+            continue;
+        }
 
-            // get the build architecture
-            //
-            std::string build_arch;
-            auto const build_arch_it(build.find("arch_tag"));
-            if(build_arch_it != build.end())
+        if(build_version == get_version())
+        {
+            if(build_state == "Successfully built")
             {
-                // date when it was last built, we keep that one!
+                built_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
+
+                // set to 1 if first; then if already 1, we're good
+                // and if set to 0, we keep it in the "failed" state
+                // because at least one version failed
                 //
-                if(build_arch_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
+                if(get_build_status() == build_status_t::BUILD_STATUS_UNKNOWN)
                 {
-                    build_arch = build_arch_it->second->get_string();
+                    set_build_status(build_status_t::BUILD_STATUS_SUCCEEDED);
                 }
             }
-            if(build_arch.empty())
-            {
-                SNAP_LOG_ERROR
-                    << "no architecture specified in this entry."
-                    << SNAP_LOG_SEND;
-                continue;
-            }
-
-            // to know whether all the versions and architectures are built
-            // we need a complete list of those for our given version
-            //
-            // TODO: this is flaky because it may take a moment for the
-            //       remote system to enter all the data; at this time,
-            //       though, we take 1 min. to re-read the state so we
-            //       should be good... assuming no huge delay on launchpad
-            //
-            if(build_version == get_version())
+            else if(build_state == "Failed to build"
+                 || build_state == "Dependency wait")
             {
-                f_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
+                built_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
+                set_build_status(build_status_t::BUILD_STATUS_FAILED);
             }
 
-            // get the build state of this entry
-            //
-            std::string build_state;
-            auto const build_state_it(build.find("buildstate"));
-            if(build_state_it != build.end())
+            if(!build.f_self_link.empty())
             {
-                if(build_state_it->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                {
-                    build_state = build_state_it->second->get_string();
-
-                    if(build_version == get_version())
-                    {
-                        if(build_state == "Successfully built")
-                        {
-                            built_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
-
-                            // set to 1 if first; then if already 1, we're good
-                            // and if set to 0, we keep it in the "failed" state
-                            // because at least one version failed
-                            //
-                            if(get_build_status() == build_status_t::BUILD_STATUS_UNKNOWN)
-                            {
-                                set_build_status(build_status_t::BUILD_STATUS_SUCCEEDED);
-                            }
-                        }
-                        else if(build_state == "Failed to build"
-                             || build_state == "Dependency wait")
-                        {
-                            built_list_of_codenames_and_archs.insert(build_codename + ':' + build_arch);
-                            set_build_status(build_status_t::BUILD_STATUS_FAILED);
-                        }
-
-                        auto const build_self_link(build.find("self_link"));
-                        if(build_self_link != build.end()
-                        && build_self_link->second->get_type() == as2js::json::json_value::type_t::JSON_TYPE_STRING)
-                        {
-                            SNAP_LOG_INFO
-                                << get_project_name()
-                                << " v"
-                                << build_version
-                                << "~"
-                                << build_codename
-                                << " for "
-                                << build_arch
-                                << ": "
-                                << date
-                                << ": Found build state \""
-                                << build_state
-                                << "\" with self-link \""
-                                << build_self_link->second->get_string()
-                                << "\". (success? "
-                                << get_build_status_string()
-                                << ")"
-                                << SNAP_LOG_SEND;
-                        }
-                    }
-                }
-            }
-            if(build_state.empty())
-            {
-                SNAP_LOG_ERROR
-                    << "no build state found in this entry."
+                SNAP_LOG_INFO
+                    << get_project_name()
+                    << " v"
+                    << build_version
+                    << "~"
+                    << build_codename
+                    << " for "
+                    << build_arch
+                    << ": "
+                    << date
+                    << ": Found build state \""
+                    << build_state
+                    << "\" with self-link \""
+                    << build.f_self_link
+                    << "\". (success? "
+                    << get_build_status_string()
+                    << ")"
                     << SNAP_LOG_SEND;
-                continue;
             }
+        }
 
-            project_remote_info::pointer_t info(std::make_shared<project_remote_info>());
-            info->set_date(date);
-            info->set_build_codename(build_codename);
-            info->set_build_state(build_state);
-            info->set_build_version(build_version);
-            info->set_build_arch(build_arch);
+        project_remote_info::pointer_t info(std::make_shared<project_remote_info>());
+        info->set_date(date);
+        info->set_build_codename(build_codename);
+        info->set_build_state(build_state);
+        info->set_build_version(build_version);
+        info->set_build_arch(build_arch);
 
-            add_remote_info(info);
-        }
+        add_remote_info(info);
+    }
 
-        if(get_building() == building_t::BUILDING_COMPILING)
+    if(get_building() == building_t::BUILDING_COMPILING)
+    {
+        if(!f_list_of_codenames_and_archs.empty()
+        && f_list_of_codenames_and_archs == built_list_of_codenames_and_archs)
         {
-            if(!f_list_of_codenames_and_archs.empty()
-            && f_list_of_codenames_and_archs == built_list_of_codenames_and_archs)
+            // the compiling is done, switch to packaging mode
+            //
+            if(get_build_status() == build_status_t::BUILD_STATUS_SUCCEEDED)
             {
-                // the compiling is done, switch to packaging mode
+                set_building(building_t::BUILDING_PACKAGING);
+
+                // TODO: find the location when the build process starts
+                //       because it would be cleaner to clear this list
+                //       at that point (especially if we want to show
+                //       the end user the status of each package for
+                //       a project)
                 //
-                if(get_build_status() == build_status_t::BUILD_STATUS_SUCCEEDED)
+                for(auto & status : f_package_statuses)
                 {
-                    set_building(building_t::BUILDING_PACKAGING);
-
-                    // TODO: find the location when the build process starts
-                    //       because it would be cleaner to clear this list
-                    //       at that point (especially if we want to show
-                    //       the end user the status of each package for
-                    //       a project)
-                    //
-                    for(auto & status : f_package_statuses)
-                    {
-                        status.second = false;
-                    }
-
-                    SNAP_LOG_INFO
-                        << "Done compiling \""
-                        << f_name
-                        << "\", starting packaging."
-                        << SNAP_LOG_SEND;
+                    status.second = false;
                 }
-                else
-                {
-                    set_building(building_t::BUILDING_NOT_BUILDING);
-
-                    // delete the flag, we are done with it
-                    //
-                    mark_as_done_building();
+                f_debs_available = 0;
+                f_debs_total = 0;
 
-                    SNAP_LOG_INFO
-                        << "Done compiling \""
-                        << f_name
-                        << "\". All were not successful. Build process stopped."
-                        << SNAP_LOG_SEND;
-                }
+                SNAP_LOG_INFO
+                    << "Done compiling \""
+                    << f_name
+                    << "\", starting packaging."
+                    << SNAP_LOG_SEND;
             }
-            else if(!f_list_of_codenames_and_archs.empty()
-                 && !built_list_of_codenames_and_archs.empty())
+            else
             {
+                set_building(building_t::BUILDING_NOT_BUILDING);
+
+                // delete the flag, we are done with it
+                //
+                mark_as_done_building();
+
                 SNAP_LOG_INFO
-                    << "Still building \""
+                    << "Done compiling \""
                     << f_name
-                    << "\", completed list of code names & architectures: \""
-                    << snapdev::join_strings(f_list_of_codenames_and_archs, ", ")
-                    << "\", list of built code names & architectures: \""
-                    << snapdev::join_strings(built_list_of_codenames_and_archs, ", ")
-                    << "\""
+                    << "\". All were not successful. Build process stopped."
                     << SNAP_LOG_SEND;
             }
         }
+        else if(!f_list_of_codenames_and_archs.empty()
+             && !built_list_of_codenames_and_archs.empty())
+        {
+            SNAP_LOG_INFO
+                << "Still building \""
+                << f_name
+                << "\", completed list of code names & architectures: \""
+                << snapdev::join_strings(f_list_of_codenames_and_archs, ", ")
+                << "\", list of built code names & architectures: \""
+                << snapdev::join_strings(built_list_of_codenames_and_archs, ", ")
+                << "\""
+                << SNAP_LOG_SEND;
+        }
     }
+}
 
-    // WARNING: the dot_deb_exists() call takes MINUTES PER .deb file
-    //          and I'm not too sure why; although it works, it's really
-    //          really slow... so when loading the app. I skip that test
+
+/** \brief Verify whether the packages of a project are available.
+ *
+ * While packaging, this function checks whether the .deb files are
+ * available. If so, the build is over.
+ *
+ * \param[in] loading  Whether the project is being loaded.
+ */
+void project::verify_packages(bool loading)
+{
+    // WARNING: the dot_deb_exists() call sends one HEAD per .deb file;
+    //          they are sent in parallel but it still requires a round
+    //          trip to launchpad so when loading the app. I skip that test
     //          and the package remains in "building" status until the
     //          timer comes off and then we test those files in the
     //          background (on the timer)
@@ -1280,6 +1393,8 @@ void project::load_remote_data(bool loading)
         //
         if(dot_deb_exists())
         {
+            record_publish_durations();
+
             set_building(building_t::BUILDING_NOT_BUILDING);
 
             // delete the flag, we are done with it
@@ -1415,28 +1530,35 @@ bool project::dot_deb_exists()
     // exists, otherwise it returns a 404. If it returns a 5XX, then
     // we probably need to try again later
     //
-    // TODO: we need to check all entries until a 3XX is returned and then
-    //       stop checking that specific entry
+    // the HEAD requests are all sent at once and each URL which returned
+    // a 3XX is marked as found so it does not get checked again
+    //
+    // when the packages-url is defined, we instead search for the .deb
+    // in the Packages.gz index of each release & architecture; that is
+    // one download per index instead of one HEAD per .deb
     //
     read_control();
     std::string const remote_version(get_remote_version());
+    package_index::pointer_t index;
+    if(!f_snap_builder->get_packages_url().empty())
+    {
+        index = f_snap_builder->get_package_index();
+    }
+    std::vector<std::string> urls;
     for(auto codename_and_arch : f_list_of_codenames_and_archs)
     {
-        std::unique_ptr<CURL, decltype(&::curl_easy_cleanup)> curl(curl_easy_init(), &::curl_easy_cleanup);
-        if(curl == nullptr)
-        {
-            SNAP_LOG_ERROR
-                << "could not properly initialize curl to check .deb availability for the \""
-                << f_name
-                << "\" project."
-                << SNAP_LOG_SEND;
-            return false;
-        }
-
         std::string::size_type const pos(codename_and_arch.find(':'));
         std::string const codename(codename_and_arch.substr(0, pos));
         std::string const arch(codename_and_arch.substr(pos + 1));
 
+        if(index != nullptr
+        && !index->refresh(codename, arch))
+        {
+            // the index is not available, try again on the next poll
+            //
+            return false;
+        }
+
         // check each package name, all the packages need to be available
         // not just the main one (although the name of the project we
         // have in our git environment is not always the name of the main
@@ -1499,7 +1621,7 @@ bool project::dot_deb_exists()
                     << "\"."
                     << SNAP_LOG_SEND;
             }
-            std::string url("https://launchpad.net/~snapcpp/+archive/ubuntu/ppa/+files/");
+            std::string url(f_snap_builder->get_deb_url());
             url += it->first;
             url += '_';
             url += remote_version;
@@ -1509,57 +1631,122 @@ bool project::dot_deb_exists()
             url += architecture;
             url += ".deb";
 
+            if(std::find(urls.begin(), urls.end(), url) == urls.end())
+            {
+                urls.push_back(url);
+            }
+
+            if(index != nullptr
+            && index->has_package(codename, arch, it->first, remote_version + '~' + codename))
+            {
+                guard_project;
+                f_package_statuses[url] = true;
+            }
+        }
+    }
+
+    // send a HEAD for each .deb we did not yet find, all at once; the
+    // HTTP client multiplexes them over its shared connections
+    //
+    struct probe_state_t
+    {
+        cppthread::mutex    f_mutex = cppthread::mutex();
+        std::size_t         f_pending = 0;
+        bool                f_failed = false;
+    };
+    std::shared_ptr<probe_state_t> state(std::make_shared<probe_state_t>());
+
+    std::size_t available(0);
+    {
+        guard_project;
+        f_debs_total = urls.size();
+        for(auto const & url : urls)
+        {
             if(f_package_statuses[url])
             {
                 // we already found that package, no need to check for it again
                 //
-                continue;
+                ++available;
             }
+        }
+        f_debs_available = available;
+        state->f_pending = urls.size() - available;
 
-            SNAP_LOG_NOTICE
-                << "checking whether .deb exists with `curl --head "
-                << url
-                << "`"
+        if(index != nullptr)
+        {
+            SNAP_LOG_INFO
+                << "project \""
+                << f_name
+                << "\": "
+                << f_debs_available
+                << '/'
+                << f_debs_total
+                << " .deb listed in the Packages indexes."
                 << SNAP_LOG_SEND;
 
-            curl_easy_setopt(curl.get(), CURLOPT_CUSTOMREQUEST, "HEAD");
-            curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl.get(), CURLOPT_DEFAULT_PROTOCOL, "https");
-            curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, g_curl_user_agent.data());
+            return available == urls.size();
+        }
+    }
 
-            CURLcode const res(curl_easy_perform(curl.get()));
-            if(res != CURLE_OK)
+    http_client::pointer_t client(f_snap_builder->get_http_client());
+    for(auto const & url : urls)
+    {
+        {
+            guard_project;
+            if(f_package_statuses[url])
             {
-                SNAP_LOG_ERROR
-                    << "curl HEAD to \""
-                    << url
-                    << "\" failed. ("
-                    << curl_easy_strerror(res)
-                    << ")."
-                    << SNAP_LOG_SEND;
-                return false;
+                continue;
             }
+        }
+
+        SNAP_LOG_NOTICE
+            << "checking whether .deb exists with `curl --head "
+            << url
+            << "`"
+            << SNAP_LOG_SEND;
 
-            long http_code(599);
-            curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &http_code);
-            if(http_code >= 400)
+        pointer_t me(shared_from_this());
+        client->start_head(url, [me, url, state](http_client::result_t result, long http_code)
             {
-                SNAP_LOG_WARNING
-                    << "curl HEAD to \""
-                    << url
-                    << "\" return HTTP error code: "
-                    << http_code
-                    << ". The package is not yet ready."
-                    << SNAP_LOG_SEND;
-                return false;
-            }
+                me->deb_probed(url, result, http_code);
 
-            // TBD: should we verify that it is a 301, 302, 303, 306, or 307?
+                cppthread::guard lock(state->f_mutex);
+                if(result == http_client::result_t::RESULT_FAILED
+                || http_code >= 400)
+                {
+                    state->f_failed = true;
+                }
+                --state->f_pending;
+                state->f_mutex.broadcast();
+            });
+    }
 
-            f_package_statuses[url] = true;
+    {
+        cppthread::guard lock(state->f_mutex);
+        while(state->f_pending > 0)
+        {
+            state->f_mutex.wait();
         }
     }
 
+    {
+        guard_project;
+        SNAP_LOG_INFO
+            << "project \""
+            << f_name
+            << "\": "
+            << f_debs_available
+            << '/'
+            << f_debs_total
+            << " .deb available."
+            << SNAP_LOG_SEND;
+    }
+
+    if(state->f_failed)
+    {
+        return false;
+    }
+
     // all the .deb seem to be available at the moment
     //
     return true;
@@ -1569,6 +1756,58 @@ bool project::dot_deb_exists()
 
 
 
+void project::deb_probed(
+      std::string const & url
+    , http_client::result_t result
+    , long http_code)
+{
+    if(result == http_client::result_t::RESULT_FAILED)
+    {
+        // the client already logged the error
+        //
+        return;
+    }
+
+    if(http_code >= 500
+    || http_code == 429)
+    {
+        // launchpad is failing, this does not tell us anything about
+        // the package; the watch gets paused until launchpad is back
+        //
+        SNAP_LOG_WARNING
+            << "curl HEAD to \""
+            << url
+            << "\" failed with HTTP error code: "
+            << http_code
+            << ". Launchpad is not available."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    if(http_code >= 400)
+    {
+        SNAP_LOG_WARNING
+            << "curl HEAD to \""
+            << url
+            << "\" return HTTP error code: "
+            << http_code
+            << ". The package is not yet ready."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    // TBD: should we verify that it is a 301, 302, 303, 306, or 307?
+
+    guard_project;
+    bool & found(f_package_statuses[url]);
+    if(!found)
+    {
+        found = true;
+        ++f_debs_available;
+    }
+}
+
+
 /** \brief Get all the dependencies of this project.
  *
  * Each project may depend on one or more other project. This list includes
@@ -1633,6 +1872,13 @@ project::dependencies_t project::get_trimmed_dependencies() const
 }
 
 
+std::string project::get_remote_info_filename() const
+{
+    std::string const & cache(f_snap_builder->get_cache_path());
+    return cache + '/' + get_project_name() + ".records";
+}
+
+
 std::string project::get_ppa_json_filename() const
 {
     std::string const & cache(f_snap_builder->get_cache_path());
@@ -1654,64 +1900,331 @@ std::string project::get_build_hash_filename() const
 }
 
 
-/** \brief Load the PPA status from LaunchPad.
+std::string project::get_state_filename() const
+{
+    std::string const & cache(f_snap_builder->get_cache_path());
+    return cache + '/' + get_project_name() + ".state";
+}
+
+
+/** \brief Compute the fingerprint of the local files.
  *
- * This function forcibly loads a copy of this project JSON which gives us
- * the status of a build (among other things).
+ * The fingerprint is composed of the modification times of the files
+ * which change whenever the local state of the project changes: the
+ * git HEAD, index and packed-refs, the directories of the remote
+ * references and the debian/changelog.
  *
- * The function should be called only if (1) we started a build and it is
- * still ongoing or (2) we do not have a version cached on our side.
- * Otherwise it's kind of a waste. The user will be given the ability
- * to by-pass the cache to make sure he can refresh the screen properly.
+ * This is very cheap (a few stat() calls) compared to running git.
  *
- * \return true if the PPA was contacted successfully.
+ * \return The fingerprint of the local files.
  */
-bool project::retrieve_ppa_status()
+std::string project::get_local_fingerprint() const
 {
-    must_be_background_thread();
+    advgetopt::string_list_t paths;
 
-    std::string cmd("wget -q --user-agent='");
-    cmd += g_wget_user_agent;
-    cmd += "' -O '";
-    cmd += get_ppa_json_filename();
-    cmd += "' '";
-    cmd += snapdev::string_replace_many(
-                  f_snap_builder->get_launchpad_url()
-                , {{ "@PROJECT_NAME@", get_project_name() }});
-    cmd += '\'';
+    std::string const git_dir(get_git_dir(f_project_path));
+    if(!git_dir.empty())
+    {
+        paths.push_back(git_dir + "/HEAD");
+        paths.push_back(git_dir + "/index");
+        paths.push_back(git_dir + "/packed-refs");
+
+        std::string const remotes(git_dir + "/refs/remotes");
+        paths.push_back(remotes);
+        DIR * d(opendir(remotes.c_str()));
+        if(d != nullptr)
+        {
+            advgetopt::string_list_t names;
+            for(struct dirent * e(readdir(d)); e != nullptr; e = readdir(d))
+            {
+                if(e->d_name[0] != '.')
+                {
+                    names.push_back(e->d_name);
+                }
+            }
+            closedir(d);
+            std::sort(names.begin(), names.end());
+            for(auto const & n : names)
+            {
+                paths.push_back(remotes + '/' + n);
+            }
+        }
+    }
+    paths.push_back(f_project_path + "/debian/changelog");
 
-    SNAP_LOG_INFO
-        << "Updating cache of \""
+    std::string fingerprint;
+    for(auto const & p : paths)
+    {
+        if(!fingerprint.empty())
+        {
+            fingerprint += ',';
+        }
+        struct stat s;
+        if(stat(p.c_str(), &s) != 0)
+        {
+            fingerprint += '-';
+        }
+        else
+        {
+            fingerprint += std::to_string(s.st_mtim.tv_sec);
+            fingerprint += '.';
+            fingerprint += std::to_string(s.st_mtim.tv_nsec);
+        }
+    }
+
+    return fingerprint;
+}
+
+
+/** \brief Load the local state from the cache.
+ *
+ * If the \<name>.state file exists and its fingerprint matches the
+ * current fingerprint of the local files, the version, state and last
+ * commit are restored from that file. The next load_project() then skips
+ * the git & changelog probes entirely.
+ *
+ * \return true if the cached state was loaded.
+ */
+bool project::load_local_state()
+{
+    if(!f_exists)
+    {
+        return false;
+    }
+
+    std::ifstream in(get_state_filename());
+    if(!in.is_open())
+    {
+        return false;
+    }
+
+    std::map<std::string, std::string> values;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        std::string::size_type const equal(line.find('='));
+        if(equal != std::string::npos)
+        {
+            values[line.substr(0, equal)] = line.substr(equal + 1);
+        }
+    }
+
+    if(values["fingerprint"] != get_local_fingerprint()
+    || values["version"].empty()
+    || values["last_commit_hash"].empty())
+    {
+        return false;
+    }
+    time_t const last_commit(atol(values["last_commit"].c_str()));
+    if(last_commit <= 0)
+    {
+        return false;
+    }
+
+    SNAP_LOG_TRACE
+        << "project \""
         << f_name
-        << "\" with command: \""
-        << cmd
-        << "\"."
+        << "\" local state loaded from cache."
         << SNAP_LOG_SEND;
 
-    int const r(system(cmd.c_str()));
-    if(r != 0)
+    set_version(values["version"]);
+    set_state(values["state"]);
+
+    guard_project;
+    f_last_commit = last_commit;
+    f_last_commit_hash = values["last_commit_hash"];
+    f_local_state_cached = true;
+    return true;
+}
+
+
+void project::save_local_state(std::string const & fingerprint)
+{
+    std::string state;
+    std::string last_commit_hash;
+    time_t last_commit(0);
+    {
+        guard_project;
+        state = f_state;
+        last_commit_hash = f_last_commit_hash;
+        last_commit = f_last_commit;
+    }
+
+    // only save the states computed from the local files
+    //
+    if(state != "ready"
+    && state != "not committed"
+    && state != "not pushed")
+    {
+        return;
+    }
+
+    std::string const filename(get_state_filename());
+    std::string const tmp(filename + ".tmp");
+    {
+        std::ofstream out(tmp);
+        if(!out.is_open())
+        {
+            return;
+        }
+        out << "fingerprint=" << fingerprint << '\n'
+            << "version=" << get_version() << '\n'
+            << "state=" << state << '\n'
+            << "last_commit=" << last_commit << '\n'
+            << "last_commit_hash=" << last_commit_hash << '\n';
+        if(!out)
+        {
+            snapdev::NOT_USED(unlink(tmp.c_str()));
+            return;
+        }
+    }
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        snapdev::NOT_USED(unlink(tmp.c_str()));
+    }
+}
+
+
+/** \brief Load the PPA status from LaunchPad.
+ *
+ * This function forcibly loads a copy of this project JSON which gives us
+ * the status of a build (among other things).
+ *
+ * The function should be called only if (1) we started a build and it is
+ * still ongoing or (2) we do not have a version cached on our side.
+ * Otherwise it's kind of a waste. The user will be given the ability
+ * to by-pass the cache to make sure he can refresh the screen properly.
+ *
+ * The request is conditional, if the JSON did not change since the last
+ * time we downloaded it, Launchpad replies with 304 and the function
+ * returns RESULT_NOT_MODIFIED. In that case, there is no need to parse
+ * the file again.
+ *
+ * \return RESULT_DOWNLOADED if the PPA status was updated,
+ * RESULT_NOT_MODIFIED if it did not change and RESULT_FAILED if the PPA
+ * could not be contacted.
+ */
+http_client::result_t project::retrieve_ppa_status()
+{
+    must_be_background_thread();
+
+    // the JSON is only kept for debugging so the request is conditional
+    // as long as the store exists
+    //
+    std::string const url(get_ppa_url());
+    http_client::result_t result(f_snap_builder->get_http_client()->download(
+                  url
+                , get_ppa_json_filename()
+                , get_remote_info_filename()));
+    if(result == http_client::result_t::RESULT_DOWNLOADED
+    && !update_remote_info_store())
+    {
+        result = http_client::result_t::RESULT_FAILED;
+    }
+    if(result == http_client::result_t::RESULT_FAILED)
     {
         SNAP_LOG_WARNING
             << "Cache of \""
             << f_name
-            << "\" could not be updated (r = "
-            << r
-            << ")."
+            << "\" could not be updated from \""
+            << url
+            << "\"."
             << SNAP_LOG_SEND;
 
-        return false;
+        return result;
     }
 
     SNAP_LOG_INFO
         << "Cache of \""
         << f_name
-        << "\" updated successfully."
+        << (result == http_client::result_t::RESULT_NOT_MODIFIED
+                ? "\" is still current."
+                : "\" updated successfully.")
         << SNAP_LOG_SEND;
 
+    return result;
+}
+
+
+/** \brief Start downloading the PPA status if not yet cached.
+ *
+ * When loading many projects, this function is called for each one of
+ * them so all the missing PPA statuses are downloaded concurrently by
+ * the HTTP client. The retrieve_ppa_status() function later called by
+ * the worker threads then joins the transfer already in progress.
+ */
+void project::prefetch_ppa_status()
+{
+    if(!f_exists
+    || access(get_remote_info_filename().c_str(), R_OK) == 0
+    || access(get_ppa_json_filename().c_str(), R_OK) == 0)
+    {
+        return;
+    }
+
+    f_snap_builder->get_http_client()->start_download(
+              get_ppa_url()
+            , get_ppa_json_filename()
+            , http_client::done_t()
+            , get_remote_info_filename());
+}
+
+
+/** \brief Convert the downloaded JSON to the remote info store.
+ *
+ * The JSON file downloaded from Launchpad is parsed once and the build
+ * records are saved in the binary store. The next loads only need to
+ * memory map the store.
+ *
+ * Unless the keep-ppa-json option is used, the JSON file is deleted
+ * once converted.
+ *
+ * If the JSON does not include any build record (i.e. the project was
+ * never built), an empty store is saved. If the JSON is not valid (i.e.
+ * we received an error page), no store is saved and the validators of
+ * the download are deleted so the next request does not return a 304.
+ *
+ * \return true if the store was updated.
+ */
+bool project::update_remote_info_store()
+{
+    std::string const json_filename(get_ppa_json_filename());
+    if(access(json_filename.c_str(), R_OK) != 0)
+    {
+        return false;
+    }
+
+    build_record::vector_t records;
+    bool empty(false);
+    if(!load_build_records(json_filename, records, nullptr, &empty)
+    && !empty)
+    {
+        unlink((json_filename + ".headers").c_str());
+        return false;
+    }
+
+    if(!remote_info_store::save(get_remote_info_filename(), records))
+    {
+        return false;
+    }
+
+    if(!f_snap_builder->get_keep_ppa_json())
+    {
+        unlink(json_filename.c_str());
+    }
+
     return true;
 }
 
 
+std::string project::get_ppa_url() const
+{
+    return snapdev::string_replace_many(
+                  f_snap_builder->get_launchpad_url()
+                , {{ "@PROJECT_NAME@", get_project_name() }});
+}
+
+
 bool project::is_building() const
 {
     guard_project;
@@ -1726,6 +2239,277 @@ bool project::is_packaging() const
 }
 
 
+/** \brief Get the builds of the current version which failed.
+ *
+ * When a build gets retried, launchpad creates a new record. Only the
+ * most recent record of each release and architecture is returned.
+ *
+ * \return The failed builds which have a build log.
+ */
+build_record::vector_t project::get_failed_builds() const
+{
+    std::string const version(get_version() + '~');
+    std::set<std::string> found;
+    build_record::vector_t failed;
+    for(build_record const & build : f_build_records)
+    {
+        if(build.f_source_package_version.compare(0, version.length(), version) != 0
+        || !found.insert(get_build_log_key(build)).second)
+        {
+            continue;
+        }
+        if(build.f_buildstate == "Failed to build"
+        && !build.f_build_log_url.empty())
+        {
+            failed.push_back(build);
+        }
+    }
+    return failed;
+}
+
+
+std::string project::get_build_log_key(build_record const & build)
+{
+    std::string const & version(build.f_source_package_version);
+    std::string::size_type const pos(version.find('~'));
+    return (pos == std::string::npos ? version : version.substr(pos + 1))
+         + '/'
+         + build.f_arch_tag;
+}
+
+
+/** \brief Check whether the build log excerpts need to be updated.
+ *
+ * \return true if the excerpts we have do not correspond to the builds
+ * that failed.
+ */
+bool project::needs_build_logs() const
+{
+    std::set<std::string> keys;
+    for(auto const & build : get_failed_builds())
+    {
+        keys.insert(get_build_log_key(build));
+    }
+
+    guard_project;
+    if(keys.size() != f_build_log_excerpts.size())
+    {
+        return true;
+    }
+    for(auto const & e : f_build_log_excerpts)
+    {
+        if(keys.find(e.first) == keys.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/** \brief Get the error lines of the builds which failed.
+ *
+ * The build log of each failed build is downloaded (only if it changed)
+ * and scanned for errors. The excerpts replace the previous ones.
+ */
+void project::fetch_build_logs()
+{
+    std::map<std::string, build_log::lines_t> excerpts;
+    for(auto const & build : get_failed_builds())
+    {
+        build_log log(f_snap_builder, build);
+        if(log.fetch())
+        {
+            excerpts[get_build_log_key(build)] = log.get_excerpt();
+        }
+    }
+
+    guard_project;
+    f_build_log_excerpts.swap(excerpts);
+}
+
+
+/** \brief Get the errors found in the failed build logs.
+ *
+ * \return The error lines of each failed build preceded by its release
+ * and architecture, or an empty string if none.
+ */
+std::string project::get_build_log_excerpt() const
+{
+    guard_project;
+    std::string result;
+    for(auto const & e : f_build_log_excerpts)
+    {
+        if(!result.empty())
+        {
+            result += '\n';
+        }
+        result += e.first;
+        result += ':';
+        if(e.second.empty())
+        {
+            result += " no error found in the build log.";
+        }
+        for(auto const & line : e.second)
+        {
+            result += "\n    ";
+            result += line;
+        }
+    }
+    return result;
+}
+
+
+/** \brief Estimate when the current build will be done.
+ *
+ * While compiling, each architecture which is not yet built is expected
+ * to take as long as its previous builds. The earliest of those times is
+ * returned since the state changes as soon as one of them is done.
+ *
+ * While packaging, the .deb files are expected once the publication
+ * duration measured on previous builds elapsed after the compilation
+ * ended. The latest of those times is returned.
+ *
+ * \return The expected completion time or 0 if unknown (i.e. launchpad
+ * did not yet create the build records).
+ */
+time_t project::get_expected_completion() const
+{
+    building_t const building(get_building());
+    std::string const version(get_version() + '~');
+    poll_scheduler::pointer_t scheduler(f_snap_builder->get_poll_scheduler());
+
+    time_t expected(0);
+    for(build_record const & build : f_build_records)
+    {
+        if(build.f_source_package_version.compare(0, version.length(), version) != 0)
+        {
+            continue;
+        }
+
+        if(building == building_t::BUILDING_COMPILING)
+        {
+            if(build.is_final())
+            {
+                continue;
+            }
+            std::int64_t start(date_to_us(build.f_date_started));
+            bool const started(start != 0);
+            if(!started)
+            {
+                start = date_to_us(build.f_datecreated);
+                if(start == 0)
+                {
+                    continue;
+                }
+            }
+            time_t const end(start / 1'000'000 + get_build_duration(build.f_arch_tag, started));
+            if(expected == 0
+            || end < expected)
+            {
+                expected = end;
+            }
+        }
+        else if(building == building_t::BUILDING_PACKAGING)
+        {
+            std::int64_t const built(date_to_us(build.f_datebuilt));
+            if(built == 0)
+            {
+                continue;
+            }
+            time_t const end(built / 1'000'000
+                        + scheduler->get_publish_duration(get_project_name(), build.f_arch_tag));
+            expected = std::max(expected, end);
+        }
+    }
+
+    return expected;
+}
+
+
+/** \brief Get the usual build duration of one architecture.
+ *
+ * The function uses the median duration of the last few successful
+ * builds of this project for that architecture. When the build did not
+ * start yet, the time spent waiting in the launchpad queue is included.
+ *
+ * \param[in] arch  The architecture being built.
+ * \param[in] started  Whether the build started.
+ *
+ * \return The expected number of seconds from the start (or creation)
+ * of the build to its end.
+ */
+time_t project::get_build_duration(std::string const & arch, bool started) const
+{
+    std::vector<time_t> durations;
+    for(build_record const & build : f_build_records)
+    {
+        if(build.f_arch_tag != arch
+        || build.f_buildstate != "Successfully built")
+        {
+            continue;
+        }
+        std::int64_t const built(date_to_us(build.f_datebuilt));
+        std::int64_t const start(date_to_us(started
+                                    ? build.f_date_started
+                                    : build.f_datecreated));
+        if(built == 0
+        || start == 0
+        || built <= start)
+        {
+            continue;
+        }
+        durations.push_back((built - start) / 1'000'000);
+        if(durations.size() >= 5)
+        {
+            break;
+        }
+    }
+    if(durations.empty())
+    {
+        // no history, assume 10 minutes
+        //
+        return 10 * 60;
+    }
+
+    std::nth_element(durations.begin(), durations.begin() + durations.size() / 2, durations.end());
+    return durations[durations.size() / 2];
+}
+
+
+/** \brief Save how long it took to publish the .deb files.
+ *
+ * This function is called once all the .deb files were found. The
+ * duration from the end of the compilation of each architecture to now
+ * is given to the poll scheduler so the next packaging checks happen
+ * around the time the .deb files are expected.
+ */
+void project::record_publish_durations()
+{
+    std::string const version(get_version() + '~');
+    std::map<std::string, std::int64_t> built;
+    for(build_record const & build : f_build_records)
+    {
+        if(build.f_source_package_version.compare(0, version.length(), version) != 0)
+        {
+            continue;
+        }
+        std::int64_t & latest(built[build.f_arch_tag]);
+        latest = std::max(latest, date_to_us(build.f_datebuilt));
+    }
+
+    time_t const now(time(nullptr));
+    poll_scheduler::pointer_t scheduler(f_snap_builder->get_poll_scheduler());
+    for(auto const & b : built)
+    {
+        if(b.second != 0)
+        {
+            scheduler->add_publish_duration(get_project_name(), b.first, now - b.second / 1'000'000);
+        }
+    }
+}
+
+
 void project::start_build()
 {
     must_be_background_thread();
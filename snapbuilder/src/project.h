@@ -23,6 +23,16 @@
 #include    <advgetopt/utils.h>
 
 
+// self
+//
+#include    "build_log.h"
+#include    "build_record.h"
+#include    "build_sweep.h"
+#include    "http_client.h"
+#include    "local_probe.h"
+#include    "repository.h"
+
+
 // eventdispatcher
 //
 #include    <cppprocess/process.h>
@@ -36,7 +46,9 @@
 // C++
 //
 #include    <memory>
+#include    <map>
 #include    <set>
+#include    <vector>
 
 
 
@@ -96,6 +108,7 @@ public:
     void                        clear_error();
     std::string const &         get_name() const;
     std::string                 get_project_name() const;
+    std::string const &         get_project_path() const;
     void                        set_version(std::string const & version);
     std::string                 get_version() const;
     std::string                 get_remote_version() const;
@@ -109,19 +122,31 @@ public:
     dependencies_t              get_dependencies() const;
     dependencies_t              get_trimmed_dependencies() const;
 
+    std::string                 get_ppa_url() const;
     std::string                 get_ppa_json_filename() const;
+    std::string                 get_remote_info_filename() const;
     std::string                 get_flag_filename() const;
     void                        mark_as_done_building();
     std::string                 get_build_hash_filename() const;
+    std::string                 get_state_filename() const;
+    std::string                 get_local_fingerprint() const;
+    bool                        load_local_state();
     void                        load_remote_data(bool load);
-    bool                        retrieve_ppa_status();
+    http_client::result_t       retrieve_ppa_status();
+    http_client::result_t       sweep_remote_data(build_sweep::pointer_t sweep);
+    void                        prefetch_ppa_status();
     bool                        is_building() const;
     bool                        is_packaging() const;
+    time_t                      get_expected_completion() const;
+    bool                        needs_build_logs() const;
+    void                        fetch_build_logs();
+    std::string                 get_build_log_excerpt() const;
 
     bool                        operator < (project const & rhs) const;
     static void                 sort(vector_t & v);
 
     void                        project_changed();
+    void                        start_local_probes(local_probe::done_t done);
     void                        load_project();
     void                        start_build();
     static void                 simplify(vector_t & v);
@@ -149,6 +174,12 @@ private:
     typedef std::map<std::string, definition_t>         package_t;
     typedef std::map<std::string, bool>                 package_status_t;
 
+    struct local_probe_output_t
+    {
+        std::string                 f_status = std::string();
+        std::string                 f_last_commit = std::string();
+    };
+
     void                        add_dependency(std::string const & name);
     void                        add_missing_dependencies(pointer_t p, map_t & m);
     static bool                 compare(pointer_t a, pointer_t b);
@@ -156,9 +187,11 @@ private:
     void                        clear_remote_info(std::size_t size);
     void                        add_remote_info(project_remote_info::pointer_t info);
     void                        find_project();
+    bool                        inspect_repository();
+    void                        save_local_state(std::string const & fingerprint);
+    void                        local_probes_done(local_probe_output_t const & output);
     bool                        retrieve_version();
     bool                        check_state();
-    bool                        get_last_commit_timestamp();
     bool                        get_last_commit_hash();
     bool                        get_build_hash();
     void                        retrieve_building_state();
@@ -166,7 +199,20 @@ private:
                                 find_remote_info(
                                       std::string const & build_codename
                                     , std::string const & build_arch);
+    bool                        update_remote_info_store();
+    void                        apply_build_records();
+    bool                        merge_build_records(build_record::vector_t const & records);
+    std::string                 get_oldest_pending_date() const;
+    void                        verify_packages(bool loading);
+    time_t                      get_build_duration(std::string const & arch, bool started) const;
+    void                        record_publish_durations();
+    build_record::vector_t      get_failed_builds() const;
+    static std::string          get_build_log_key(build_record const & build);
     bool                        dot_deb_exists();
+    void                        deb_probed(
+                                      std::string const & url
+                                    , http_client::result_t result
+                                    , long http_code);
     void                        set_building(building_t building);
     building_t                  get_building() const;
     void                        set_build_status(build_status_t status);
@@ -174,6 +220,7 @@ private:
     char const *                get_build_status_string() const;
     void                        add_error(std::string const & msg);
     void                        must_be_background_thread();
+    std::uint32_t               update_display_fingerprint();
     void                        read_control();
 
     snap_builder *              f_snap_builder = nullptr;
@@ -187,6 +234,9 @@ private:
     std::string                 f_build_hash = std::string();
     bool                        f_exists = false;
     bool                        f_loaded = false;
+    bool                        f_repository_probed = false;
+    bool                        f_local_state_cached = false;
+    std::string                 f_fingerprint = std::string();
     bool                        f_valid = false;
     bool                        f_recursed_add_dependencies = false;
     building_t                  f_building = building_t::BUILDING_NOT_BUILDING;
@@ -195,10 +245,16 @@ private:
     dependencies_t              f_trimmed_dependencies = dependencies_t();
     project_remote_info::vector_t
                                 f_remote_info = project_remote_info::vector_t();
+    build_record::vector_t      f_build_records = build_record::vector_t();
     std::set<std::string>       f_list_of_codenames_and_archs = std::set<std::string>();
     definition_t                f_control_info = definition_t();
     package_t                   f_control_packages = package_t();
     package_status_t            f_package_statuses = package_status_t();
+    std::size_t                 f_debs_available = 0;
+    std::size_t                 f_debs_total = 0;
+    std::vector<std::size_t>    f_display_fingerprint = std::vector<std::size_t>();
+    std::map<std::string, build_log::lines_t>
+                                f_build_log_excerpts = std::map<std::string, build_log::lines_t>();
 };
 
 
@@ -0,0 +1,243 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "project_watcher.h"
+
+#include    "repository.h"
+#include    "snap_builder.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C
+//
+#include    <dirent.h>
+#include    <sys/stat.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+constexpr ed::file_event_mask_t const g_watch_events =
+          ed::SNAP_FILE_CHANGED_EVENT_WRITE
+        | ed::SNAP_FILE_CHANGED_EVENT_CREATED
+        | ed::SNAP_FILE_CHANGED_EVENT_DELETED;
+
+
+} // no name namespace
+
+
+
+project_watcher::project_watcher(snap_builder * parent)
+    : f_snap_builder(parent)
+{
+    set_name("project_watcher");
+}
+
+
+/** \brief Watch the files of all the specified projects.
+ *
+ * Any existing watches are first removed so this function can be called
+ * each time the list of projects gets reloaded.
+ *
+ * \param[in] projects  The list of projects to watch.
+ */
+void project_watcher::watch_projects(project::vector_t const & projects)
+{
+    clear();
+
+    for(auto const & p : projects)
+    {
+        if(p->exists())
+        {
+            watch_project(p);
+        }
+    }
+
+    SNAP_LOG_DEBUG
+        << "watching "
+        << f_watched.size()
+        << " directories for local changes."
+        << SNAP_LOG_SEND;
+}
+
+
+void project_watcher::clear()
+{
+    for(auto const & w : f_watched)
+    {
+        stop_watch(w.first);
+    }
+    f_watched.clear();
+}
+
+
+void project_watcher::watch_project(project::pointer_t p)
+{
+    std::string const git_dir(get_git_dir(p->get_project_path()));
+    if(!git_dir.empty())
+    {
+        add_watch(git_dir, p, watch_t::WATCH_GIT_DIR);
+
+        // the remote references are in one sub-directory per remote
+        //
+        std::string const remotes(git_dir + "/refs/remotes");
+        DIR * d(opendir(remotes.c_str()));
+        if(d != nullptr)
+        {
+            for(struct dirent * e(readdir(d)); e != nullptr; e = readdir(d))
+            {
+                if(e->d_name[0] != '.')
+                {
+                    watch_remote_refs(remotes + '/' + e->d_name, p);
+                }
+            }
+            closedir(d);
+        }
+    }
+
+    add_watch(p->get_project_path() + "/debian", p, watch_t::WATCH_DEBIAN);
+}
+
+
+/** \brief Watch a directory of remote references and its sub-directories.
+ *
+ * inotify is not recursive and a branch with slashes in its name (i.e.
+ * `origin/feature/x`) is saved in sub-directories, so each one of them
+ * gets its own watch.
+ *
+ * \param[in] path  The directory to watch.
+ * \param[in] p  The project these references belong to.
+ */
+void project_watcher::watch_remote_refs(
+      std::string const & path
+    , project::pointer_t p)
+{
+    add_watch(path, p, watch_t::WATCH_REMOTE_REFS);
+
+    DIR * d(opendir(path.c_str()));
+    if(d == nullptr)
+    {
+        return;
+    }
+    for(struct dirent * e(readdir(d)); e != nullptr; e = readdir(d))
+    {
+        if(e->d_name[0] != '.'
+        && (e->d_type == DT_DIR || e->d_type == DT_UNKNOWN))
+        {
+            watch_remote_refs(path + '/' + e->d_name, p);
+        }
+    }
+    closedir(d);
+}
+
+
+void project_watcher::add_watch(
+      std::string const & path
+    , project::pointer_t p
+    , watch_t type)
+{
+    struct stat s;
+    if(stat(path.c_str(), &s) != 0
+    || !S_ISDIR(s.st_mode))
+    {
+        return;
+    }
+
+    watched_t w;
+    w.f_project = p;
+    w.f_type = type;
+    f_watched[path] = w;
+
+    watch_directory(path, g_watch_events);
+}
+
+
+void project_watcher::process_event(ed::file_event const & watch_event)
+{
+    auto it(f_watched.find(watch_event.get_watched_path()));
+    if(it == f_watched.end())
+    {
+        return;
+    }
+
+    std::string const & filename(watch_event.get_filename());
+    switch(it->second.f_type)
+    {
+    case watch_t::WATCH_GIT_DIR:
+        if(filename != "HEAD"
+        && filename != "index"
+        && filename != "packed-refs")
+        {
+            return;
+        }
+        break;
+
+    case watch_t::WATCH_REMOTE_REFS:
+        if(filename.length() >= 5
+        && filename.compare(filename.length() - 5, 5, ".lock") == 0)
+        {
+            return;
+        }
+        if((watch_event.get_events() & ed::SNAP_FILE_CHANGED_EVENT_CREATED) != 0
+        && (watch_event.get_events() & ed::SNAP_FILE_CHANGED_EVENT_DIRECTORY) != 0)
+        {
+            // a new branch with a slash in its name creates a directory
+            //
+            watch_remote_refs(
+                      watch_event.get_watched_path() + '/' + filename
+                    , it->second.f_project);
+        }
+        break;
+
+    case watch_t::WATCH_DEBIAN:
+        if(filename != "changelog")
+        {
+            return;
+        }
+        break;
+
+    }
+
+    SNAP_LOG_TRACE
+        << "local change detected in \""
+        << watch_event.get_watched_path()
+        << '/'
+        << filename
+        << "\"."
+        << SNAP_LOG_SEND;
+
+    f_snap_builder->project_files_changed(it->second.f_project);
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
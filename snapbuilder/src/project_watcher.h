@@ -0,0 +1,111 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    "project.h"
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/file_changed.h>
+
+
+// C++
+//
+#include    <map>
+
+
+
+namespace builder
+{
+
+
+
+class snap_builder;
+
+
+/** \brief Watch the local files of the projects.
+ *
+ * This connection uses inotify to watch the files which, when modified,
+ * change the local state of a project:
+ *
+ * * `.git/HEAD`, `.git/index` and `.git/packed-refs` -- a commit, a
+ * checkout, staged changes, a fetch
+ * * `.git/refs/remotes/<remote>/...` -- the upstream references (push,
+ * fetch, pull); the sub-directories are watched too since a branch
+ * named `feature/x` is saved in a `feature` sub-directory
+ * * `debian/changelog` -- the version
+ *
+ * Since git and editors replace files by renaming a temporary file, the
+ * parent directories are watched and the events are filtered by filename.
+ *
+ * When such a file changes, the snap_builder is told to reload that one
+ * project. Unchanged projects do not cost anything.
+ */
+class project_watcher
+    : public ed::file_changed
+{
+public:
+    typedef std::shared_ptr<project_watcher>    pointer_t;
+
+                                project_watcher(snap_builder * parent);
+                                project_watcher(project_watcher const &) = delete;
+    project_watcher &           operator = (project_watcher const &) = delete;
+
+    void                        watch_projects(project::vector_t const & projects);
+    void                        clear();
+
+    // ed::file_changed implementation
+    virtual void                process_event(ed::file_event const & watch_event) override;
+
+private:
+    enum class watch_t
+    {
+        WATCH_GIT_DIR,
+        WATCH_REMOTE_REFS,
+        WATCH_DEBIAN,
+    };
+
+    struct watched_t
+    {
+        project::pointer_t          f_project = project::pointer_t();
+        watch_t                     f_type = watch_t::WATCH_GIT_DIR;
+    };
+
+    typedef std::map<std::string, watched_t>    watched_map_t;
+
+    void                        watch_project(project::pointer_t p);
+    void                        watch_remote_refs(
+                                      std::string const & path
+                                    , project::pointer_t p);
+    void                        add_watch(
+                                      std::string const & path
+                                    , project::pointer_t p
+                                    , watch_t type);
+
+    snap_builder *              f_snap_builder = nullptr;
+    watched_map_t               f_watched = watched_map_t();
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,252 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "remote_health.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+// number of failures in a row before we stop sending requests
+//
+constexpr int const         g_failure_threshold = 5;
+
+// the first pause once the circuit opens, then it doubles each time the
+// probe fails, up to the maximum
+//
+constexpr time_t const      g_min_pause = 60;
+constexpr time_t const      g_max_pause = 30 * 60;
+
+// how long the jobs wait for the probe result before checking again
+//
+constexpr int const         g_probe_wait = 10;
+
+// a probe without an answer after that long is considered lost (it is
+// longer than the HTTP client transfer timeout)
+//
+constexpr time_t const      g_probe_timeout = 6 * 60;
+
+// the retry delays of the jobs
+//
+constexpr int const         g_base_backoff = 60;
+constexpr int const         g_max_backoff = 30 * 60;
+
+
+} // no name namespace
+
+
+
+remote_health::remote_health()
+{
+}
+
+
+/** \brief Check whether a request can be sent to launchpad.
+ *
+ * While the circuit is closed, all the requests are allowed. Once it
+ * is open, no request is allowed until the pause is over. At that
+ * point, the first request becomes the probe and the other requests
+ * are refused until the probe result is known.
+ *
+ * \return true if the request can be sent.
+ */
+bool remote_health::allow_request()
+{
+    time_t const now(time(nullptr));
+
+    cppthread::guard lock(f_mutex);
+    switch(f_state)
+    {
+    case state_t::STATE_CLOSED:
+        return true;
+
+    case state_t::STATE_OPEN:
+        if(now < f_retry_at)
+        {
+            return false;
+        }
+        break;
+
+    case state_t::STATE_HALF_OPEN:
+        if(now < f_probe_started + g_probe_timeout)
+        {
+            return false;
+        }
+        break;
+
+    }
+
+    SNAP_LOG_INFO
+        << "sending a probe request to check whether launchpad is available again."
+        << SNAP_LOG_SEND;
+
+    f_state = state_t::STATE_HALF_OPEN;
+    f_probe_started = now;
+    return true;
+}
+
+
+void remote_health::report_success()
+{
+    cppthread::guard lock(f_mutex);
+    if(f_state != state_t::STATE_CLOSED)
+    {
+        SNAP_LOG_INFO
+            << "launchpad is available again, resuming the requests."
+            << SNAP_LOG_SEND;
+    }
+    f_state = state_t::STATE_CLOSED;
+    f_failures = 0;
+    f_trips = 0;
+}
+
+
+void remote_health::report_failure()
+{
+    time_t const now(time(nullptr));
+
+    cppthread::guard lock(f_mutex);
+    switch(f_state)
+    {
+    case state_t::STATE_CLOSED:
+        ++f_failures;
+        if(f_failures >= g_failure_threshold)
+        {
+            open(now);
+        }
+        break;
+
+    case state_t::STATE_OPEN:
+        // a request sent before the circuit opened
+        //
+        break;
+
+    case state_t::STATE_HALF_OPEN:
+        open(now);
+        break;
+
+    }
+}
+
+
+remote_health::state_t remote_health::get_state() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_state;
+}
+
+
+/** \brief Get the number of seconds the launchpad jobs have to wait.
+ *
+ * \return 0 if the jobs can run now, the number of seconds until the
+ * next attempt otherwise.
+ */
+int remote_health::get_pause() const
+{
+    time_t const now(time(nullptr));
+
+    cppthread::guard lock(f_mutex);
+    switch(f_state)
+    {
+    case state_t::STATE_CLOSED:
+        return 0;
+
+    case state_t::STATE_OPEN:
+        return f_retry_at > now ? static_cast<int>(f_retry_at - now) : 0;
+
+    case state_t::STATE_HALF_OPEN:
+        return now < f_probe_started + g_probe_timeout ? g_probe_wait : 0;
+
+    }
+
+    return 0;
+}
+
+
+/** \brief Compute the delay before retrying a failed job.
+ *
+ * The delay is a random number between 1 second and the exponential
+ * backoff of the \p attempt (full jitter).
+ *
+ * \param[in] attempt  The number of attempts so far, 0 to get a small
+ * random delay only used to spread the jobs.
+ *
+ * \return The number of seconds to wait.
+ */
+int remote_health::get_retry_delay(int attempt)
+{
+    int const backoff(attempt <= 0
+            ? g_probe_wait
+            : std::min(g_base_backoff << std::min(attempt, 10), g_max_backoff));
+
+    cppthread::guard lock(f_mutex);
+    return std::uniform_int_distribution<int>(1, backoff)(f_random);
+}
+
+
+/** \brief Open the circuit.
+ *
+ * \warning
+ * The mutex must be locked by the caller.
+ *
+ * \param[in] now  The current time.
+ */
+void remote_health::open(time_t now)
+{
+    time_t const pause(std::min(g_min_pause << std::min(f_trips, 10), g_max_pause));
+    ++f_trips;
+    f_state = state_t::STATE_OPEN;
+    f_retry_at = now + pause;
+
+    SNAP_LOG_WARNING
+        << "launchpad is failing ("
+        << f_failures
+        << " failures in a row), pausing all the requests for "
+        << pause
+        << " seconds."
+        << SNAP_LOG_SEND;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
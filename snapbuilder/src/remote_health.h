@@ -0,0 +1,94 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <ctime>
+#include    <memory>
+#include    <random>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Track whether launchpad is currently answering.
+ *
+ * All the requests sent to launchpad report their outcome here. A
+ * request which times out, cannot connect, or gets a 5xx (or 429)
+ * answer is a failure. Any other answer, including a 404, proves that
+ * launchpad is responsive.
+ *
+ * After a few failures in a row, the circuit opens: the HTTP client
+ * fails all the new requests immediately and the launchpad jobs get
+ * paused. Once the pause is over, a single request goes through as a
+ * probe. If it succeeds, the circuit closes and everything resumes;
+ * otherwise the circuit opens again for twice as long.
+ *
+ * The object also computes the retry delays of the jobs, an exponential
+ * backoff with full jitter (a random delay between 1 second and the
+ * exponential delay) so failing jobs do not all retry at the same time.
+ */
+class remote_health
+{
+public:
+    typedef std::shared_ptr<remote_health>      pointer_t;
+
+    enum class state_t
+    {
+        STATE_CLOSED,       // launchpad is answering
+        STATE_OPEN,         // launchpad is failing, wait for the pause to end
+        STATE_HALF_OPEN,    // one probe request was sent
+    };
+
+                                remote_health();
+                                remote_health(remote_health const &) = delete;
+    remote_health &             operator = (remote_health const &) = delete;
+
+    bool                        allow_request();
+    void                        report_success();
+    void                        report_failure();
+    state_t                     get_state() const;
+    int                         get_pause() const;
+    int                         get_retry_delay(int attempt);
+
+private:
+    void                        open(time_t now);
+
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    state_t                     f_state = state_t::STATE_CLOSED;
+    int                         f_failures = 0;
+    int                         f_trips = 0;
+    time_t                      f_retry_at = 0;
+    time_t                      f_probe_started = 0;
+    std::mt19937                f_random = std::mt19937(std::random_device()());
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
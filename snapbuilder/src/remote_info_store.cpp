@@ -0,0 +1,334 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "remote_info_store.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <fstream>
+#include    <map>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <stdio.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+
+namespace builder
+{
+
+
+namespace
+{
+
+
+constexpr char const            g_magic[4] = { 'S', 'B', 'R', 'I' };
+constexpr std::uint32_t const   g_format_version = 2;
+
+
+} // no name namespace
+
+
+
+struct remote_info_store::header_t
+{
+    char                f_magic[4] = {};
+    std::uint32_t       f_version = 0;
+    std::uint32_t       f_record_count = 0;
+    std::uint32_t       f_string_count = 0;
+    std::uint32_t       f_strings_size = 0;
+    std::uint32_t       f_reserved = 0;
+};
+
+
+struct remote_info_store::record_t
+{
+    std::uint32_t       f_source_package_name = 0;
+    std::uint32_t       f_source_package_version = 0;
+    std::uint32_t       f_arch_tag = 0;
+    std::uint32_t       f_buildstate = 0;
+    std::uint32_t       f_self_link = 0;
+    std::uint32_t       f_build_log_url = 0;
+    std::int64_t        f_datebuilt = 0;
+    std::int64_t        f_date_started = 0;
+    std::int64_t        f_datecreated = 0;
+};
+
+
+remote_info_store::~remote_info_store()
+{
+    close();
+}
+
+
+/** \brief Memory map a store.
+ *
+ * The file is verified before it gets used. If anything is wrong, the
+ * function returns false and the caller is expected to rebuild the file
+ * from the Launchpad data.
+ *
+ * \param[in] filename  The name of the store file.
+ *
+ * \return true if the file is now mapped.
+ */
+bool remote_info_store::open(std::string const & filename)
+{
+    close();
+
+    int const fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0
+    || static_cast<std::size_t>(st.st_size) < sizeof(header_t))
+    {
+        ::close(fd);
+        SNAP_LOG_ERROR
+            << "remote info store \""
+            << filename
+            << "\" is too small."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    f_size = st.st_size;
+    f_data = mmap(nullptr, f_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(f_data == MAP_FAILED)
+    {
+        f_data = nullptr;
+        f_size = 0;
+        return false;
+    }
+
+    char const * ptr(static_cast<char const *>(f_data));
+    f_header = reinterpret_cast<header_t const *>(ptr);
+    std::size_t const records_offset(sizeof(header_t));
+    std::size_t const offsets_offset(records_offset + f_header->f_record_count * sizeof(record_t));
+    std::size_t const strings_offset(offsets_offset + f_header->f_string_count * sizeof(std::uint32_t));
+    if(memcmp(f_header->f_magic, g_magic, sizeof(g_magic)) != 0
+    || f_header->f_version != g_format_version
+    || strings_offset + f_header->f_strings_size != f_size
+    || (f_header->f_strings_size > 0 && ptr[f_size - 1] != '\0'))
+    {
+        SNAP_LOG_ERROR
+            << "remote info store \""
+            << filename
+            << "\" is not valid."
+            << SNAP_LOG_SEND;
+        close();
+        return false;
+    }
+
+    f_records = reinterpret_cast<record_t const *>(ptr + records_offset);
+    f_offsets = reinterpret_cast<std::uint32_t const *>(ptr + offsets_offset);
+    f_strings = ptr + strings_offset;
+
+    for(std::uint32_t idx(0); idx < f_header->f_string_count; ++idx)
+    {
+        if(f_offsets[idx] >= f_header->f_strings_size)
+        {
+            SNAP_LOG_ERROR
+                << "remote info store \""
+                << filename
+                << "\" has an invalid string offset."
+                << SNAP_LOG_SEND;
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void remote_info_store::close()
+{
+    if(f_data != nullptr)
+    {
+        munmap(f_data, f_size);
+    }
+    f_data = nullptr;
+    f_size = 0;
+    f_header = nullptr;
+    f_records = nullptr;
+    f_offsets = nullptr;
+    f_strings = nullptr;
+}
+
+
+std::size_t remote_info_store::size() const
+{
+    return f_header == nullptr ? 0 : f_header->f_record_count;
+}
+
+
+build_record remote_info_store::get_record(std::size_t idx) const
+{
+    build_record r;
+    if(idx < size())
+    {
+        record_t const & rec(f_records[idx]);
+        r.f_source_package_name = get_string(rec.f_source_package_name);
+        r.f_source_package_version = get_string(rec.f_source_package_version);
+        r.f_arch_tag = get_string(rec.f_arch_tag);
+        r.f_buildstate = get_string(rec.f_buildstate);
+        r.f_self_link = get_string(rec.f_self_link);
+        r.f_build_log_url = get_string(rec.f_build_log_url);
+        r.f_datebuilt = us_to_date(rec.f_datebuilt);
+        r.f_date_started = us_to_date(rec.f_date_started);
+        r.f_datecreated = us_to_date(rec.f_datecreated);
+    }
+    return r;
+}
+
+
+void remote_info_store::get_records(build_record::vector_t & records) const
+{
+    std::size_t const max(size());
+    records.reserve(records.size() + max);
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        records.push_back(get_record(idx));
+    }
+}
+
+
+std::string remote_info_store::get_string(std::uint32_t idx) const
+{
+    if(idx >= f_header->f_string_count)
+    {
+        return std::string();
+    }
+    return f_strings + f_offsets[idx];
+}
+
+
+/** \brief Save records to a store file.
+ *
+ * The file is written to a temporary file which then gets renamed so
+ * a reader never sees a partial file.
+ *
+ * \param[in] filename  The name of the store file.
+ * \param[in] records  The records to save.
+ *
+ * \return true if the file was saved.
+ */
+bool remote_info_store::save(
+      std::string const & filename
+    , build_record::vector_t const & records)
+{
+    std::map<std::string, std::uint32_t> ids;
+    std::vector<std::uint32_t> offsets;
+    std::string strings;
+    auto intern = [&](std::string const & s)
+    {
+        auto const it(ids.find(s));
+        if(it != ids.end())
+        {
+            return it->second;
+        }
+        std::uint32_t const id(offsets.size());
+        ids[s] = id;
+        offsets.push_back(strings.length());
+        strings += s;
+        strings += '\0';
+        return id;
+    };
+
+    std::vector<record_t> recs;
+    recs.reserve(records.size());
+    for(auto const & r : records)
+    {
+        record_t rec;
+        rec.f_source_package_name = intern(r.f_source_package_name);
+        rec.f_source_package_version = intern(r.f_source_package_version);
+        rec.f_arch_tag = intern(r.f_arch_tag);
+        rec.f_buildstate = intern(r.f_buildstate);
+        rec.f_self_link = intern(r.f_self_link);
+        rec.f_build_log_url = intern(r.f_build_log_url);
+        rec.f_datebuilt = date_to_us(r.f_datebuilt);
+        rec.f_date_started = date_to_us(r.f_date_started);
+        rec.f_datecreated = date_to_us(r.f_datecreated);
+        recs.push_back(rec);
+    }
+
+    header_t header;
+    memcpy(header.f_magic, g_magic, sizeof(g_magic));
+    header.f_version = g_format_version;
+    header.f_record_count = recs.size();
+    header.f_string_count = offsets.size();
+    header.f_strings_size = strings.length();
+
+    std::string const tmp(filename + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const *>(recs.data()), recs.size() * sizeof(record_t));
+        out.write(reinterpret_cast<char const *>(offsets.data()), offsets.size() * sizeof(std::uint32_t));
+        out.write(strings.data(), strings.length());
+        if(!out)
+        {
+            SNAP_LOG_ERROR
+                << "could not write remote info store \""
+                << tmp
+                << "\"."
+                << SNAP_LOG_SEND;
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        SNAP_LOG_ERROR
+            << "could not rename \""
+            << tmp
+            << "\" to \""
+            << filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,92 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// self
+//
+#include    "build_record.h"
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Compact binary cache of the build records of a project.
+ *
+ * The build records downloaded from Launchpad are converted once to
+ * this format and saved in ~/.cache/snapbuilder/\<name>.records. The
+ * following loads memory map that file instead of parsing the JSON
+ * again.
+ *
+ * The file is composed of:
+ *
+ * \li a header (magic, version, counts);
+ * \li an array of fixed size records;
+ * \li an array of offsets to the strings;
+ * \li the strings, each one ending with a '\\0'.
+ *
+ * The records reference strings by index. Each string is saved once so
+ * the names, versions, architectures and states which repeat in most
+ * records only take four bytes per record. The dates are saved as
+ * microseconds since the Unix epoch.
+ */
+class remote_info_store
+{
+public:
+                                remote_info_store() = default;
+                                remote_info_store(remote_info_store const &) = delete;
+                                ~remote_info_store();
+    remote_info_store &         operator = (remote_info_store const &) = delete;
+
+    bool                        open(std::string const & filename);
+    void                        close();
+    std::size_t                 size() const;
+    build_record                get_record(std::size_t idx) const;
+    void                        get_records(build_record::vector_t & records) const;
+
+    static bool                 save(
+                                      std::string const & filename
+                                    , build_record::vector_t const & records);
+
+private:
+    struct header_t;
+    struct record_t;
+
+    std::string                 get_string(std::uint32_t idx) const;
+
+    void *                      f_data = nullptr;
+    std::size_t                 f_size = 0;
+    header_t const *            f_header = nullptr;
+    record_t const *            f_records = nullptr;
+    std::uint32_t const *       f_offsets = nullptr;
+    char const *                f_strings = nullptr;
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,600 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "repository.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/trim_string.h>
+
+
+// advgetopt
+//
+#include    <advgetopt/utils.h>
+
+
+// libgit2
+//
+#ifdef HAVE_LIBGIT2
+#include    <git2.h>
+#endif
+
+
+// C++
+//
+#include    <cstdlib>
+#include    <fstream>
+
+
+// C
+//
+#include    <stdio.h>
+#include    <sys/stat.h>
+
+
+
+namespace builder
+{
+
+
+
+/** \brief Determine the git directory of a project.
+ *
+ * In most cases, this is the `.git` sub-directory. For submodules and
+ * worktrees, `.git` is a file with a `gitdir: <path>` line which we
+ * follow.
+ *
+ * \param[in] project_path  The path to the project.
+ *
+ * \return The path to the git directory or an empty string.
+ */
+std::string get_git_dir(std::string const & project_path)
+{
+    std::string const dot_git(project_path + "/.git");
+    struct stat s;
+    if(stat(dot_git.c_str(), &s) != 0)
+    {
+        return std::string();
+    }
+    if(S_ISDIR(s.st_mode))
+    {
+        return dot_git;
+    }
+
+    std::ifstream in(dot_git);
+    std::string line;
+    if(!std::getline(in, line)
+    || line.compare(0, 8, "gitdir: ") != 0)
+    {
+        return std::string();
+    }
+
+    std::string const git_dir(snapdev::trim_string(line.substr(8)));
+    if(git_dir.empty())
+    {
+        return std::string();
+    }
+    if(git_dir[0] == '/')
+    {
+        return git_dir;
+    }
+    return project_path + '/' + git_dir;
+}
+
+
+/** \brief Parse the output of `git status --porcelain=v2 --branch`.
+ *
+ * The headers give us the HEAD commit, branch, upstream branch and
+ * the ahead/behind counters:
+ *
+ * \code
+ *     # branch.oid <commit> | (initial)
+ *     # branch.head <branch> | (detached)
+ *     # branch.upstream <upstream-branch>
+ *     # branch.ab +<ahead> -<behind>
+ * \endcode
+ *
+ * The other lines describe changed files. Ordinary (1), renamed or
+ * copied (2) and unmerged (u) entries count as changes. Untracked (?)
+ * and ignored (!) files do not, as with `git diff-index HEAD`; the
+ * command is run with --untracked-files=no so git does not even search
+ * for them.
+ *
+ * \param[in] output  The output of the git status command.
+ *
+ * \return true if the output included the branch.oid header.
+ */
+bool repository_status::parse_porcelain(std::string const & output)
+{
+    f_head.clear();
+    f_branch.clear();
+    f_upstream.clear();
+    f_ahead = 0;
+    f_behind = 0;
+    f_changes = 0;
+
+    advgetopt::string_list_t lines;
+    advgetopt::split_string(output, lines, {"\n"});
+    for(auto const & l : lines)
+    {
+        if(l.empty())
+        {
+            continue;
+        }
+
+        switch(l[0])
+        {
+        case '#':
+            if(l.compare(0, 13, "# branch.oid ") == 0)
+            {
+                f_head = snapdev::trim_string(l.substr(13));
+                if(f_head == "(initial)")
+                {
+                    f_head.clear();
+                }
+            }
+            else if(l.compare(0, 14, "# branch.head ") == 0)
+            {
+                f_branch = snapdev::trim_string(l.substr(14));
+            }
+            else if(l.compare(0, 18, "# branch.upstream ") == 0)
+            {
+                f_upstream = snapdev::trim_string(l.substr(18));
+            }
+            else if(l.compare(0, 12, "# branch.ab ") == 0)
+            {
+                // "+<ahead> -<behind>"
+                //
+                std::string::size_type const minus(l.find(" -", 12));
+                f_ahead = std::atoi(l.c_str() + 12 + (l[12] == '+' ? 1 : 0));
+                if(minus != std::string::npos)
+                {
+                    f_behind = std::atoi(l.c_str() + minus + 2);
+                }
+            }
+            break;
+
+        case '1':
+        case '2':
+        case 'u':
+            ++f_changes;
+            break;
+
+        default:
+            // untracked & ignored files
+            break;
+
+        }
+    }
+
+    return !f_head.empty();
+}
+
+
+/** \brief Parse the output of `git log -1 --format=%H%x00%ct`.
+ *
+ * The output is the hash of the last commit and its timestamp separated
+ * by a NUL character.
+ *
+ * \param[in] output  The output of the git log command.
+ *
+ * \return true if both the hash and timestamp were found.
+ */
+bool repository_status::parse_last_commit(std::string const & output)
+{
+    f_last_commit_hash.clear();
+    f_last_commit = 0;
+
+    std::string::size_type const nul(output.find('\0'));
+    if(nul == std::string::npos)
+    {
+        return false;
+    }
+
+    f_last_commit_hash = snapdev::trim_string(output.substr(0, nul));
+    f_last_commit = std::atol(output.c_str() + nul + 1);
+
+    return !f_last_commit_hash.empty() && f_last_commit > 0;
+}
+
+
+void repository_status::set_head(std::string const & head)
+{
+    f_head = head;
+}
+
+
+void repository_status::set_branch(std::string const & branch)
+{
+    f_branch = branch;
+}
+
+
+void repository_status::set_upstream(std::string const & upstream)
+{
+    f_upstream = upstream;
+}
+
+
+void repository_status::set_ahead_behind(int ahead, int behind)
+{
+    f_ahead = ahead;
+    f_behind = behind;
+}
+
+
+void repository_status::set_changes(std::size_t changes)
+{
+    f_changes = changes;
+}
+
+
+void repository_status::set_last_commit(std::string const & hash, time_t timestamp)
+{
+    f_last_commit_hash = hash;
+    f_last_commit = timestamp;
+}
+
+
+std::string const & repository_status::get_head() const
+{
+    return f_head;
+}
+
+
+std::string const & repository_status::get_branch() const
+{
+    return f_branch;
+}
+
+
+std::string const & repository_status::get_upstream() const
+{
+    return f_upstream;
+}
+
+
+int repository_status::get_ahead() const
+{
+    return f_ahead;
+}
+
+
+int repository_status::get_behind() const
+{
+    return f_behind;
+}
+
+
+std::size_t repository_status::get_changes() const
+{
+    return f_changes;
+}
+
+
+std::string const & repository_status::get_last_commit_hash() const
+{
+    return f_last_commit_hash;
+}
+
+
+time_t repository_status::get_last_commit() const
+{
+    return f_last_commit;
+}
+
+
+bool repository_status::is_committed() const
+{
+    return f_changes == 0;
+}
+
+
+/** \brief Check whether HEAD was pushed.
+ *
+ * The repository is considered pushed when it has an upstream branch
+ * and HEAD is neither ahead nor behind it (i.e. `@{u}` is `HEAD`).
+ *
+ * \return true if the HEAD commit is the upstream commit.
+ */
+bool repository_status::is_pushed() const
+{
+    return !f_upstream.empty()
+        && f_ahead == 0
+        && f_behind == 0;
+}
+
+
+/** \brief Get the state as used by the project.
+ *
+ * \return "not committed", "not pushed" or "ready".
+ */
+std::string repository_status::get_state() const
+{
+    if(!is_committed())
+    {
+        return "not committed";
+    }
+
+    if(!is_pushed())
+    {
+        return "not pushed";
+    }
+
+    return "ready";
+}
+
+
+
+
+#ifdef HAVE_LIBGIT2
+namespace
+{
+
+
+
+/** \brief Inspect a repository with libgit2.
+ *
+ * This implementation reads the repository files directly. This is much
+ * faster than starting git processes, especially when loading the entire
+ * tree of projects.
+ */
+class libgit2_repository_inspector
+    : public repository_inspector
+{
+public:
+                                libgit2_repository_inspector();
+    virtual                     ~libgit2_repository_inspector() override;
+
+    virtual bool                inspect(std::string const & path, repository_status & status) override;
+    virtual bool                is_in_process() const override;
+
+private:
+    bool                        inspect_repository(git_repository * repo, repository_status & status);
+
+    shell_repository_inspector  f_fallback = shell_repository_inspector();
+};
+
+
+std::string oid_to_string(git_oid const * oid)
+{
+    char buf[GIT_OID_HEXSZ + 1];
+    git_oid_tostr(buf, sizeof(buf), oid);
+    return buf;
+}
+
+
+libgit2_repository_inspector::libgit2_repository_inspector()
+{
+    git_libgit2_init();
+}
+
+
+libgit2_repository_inspector::~libgit2_repository_inspector()
+{
+    git_libgit2_shutdown();
+}
+
+
+bool libgit2_repository_inspector::inspect(std::string const & path, repository_status & status)
+{
+    git_repository * repo(nullptr);
+    if(git_repository_open_ext(&repo, path.c_str(), 0, nullptr) != 0)
+    {
+        git_error const * e(git_error_last());
+        SNAP_LOG_WARNING
+            << "libgit2 could not open \""
+            << path
+            << "\" ("
+            << (e == nullptr ? "unknown error" : e->message)
+            << "); falling back to the git command."
+            << SNAP_LOG_SEND;
+        return f_fallback.inspect(path, status);
+    }
+
+    bool const result(inspect_repository(repo, status));
+    git_repository_free(repo);
+    if(!result)
+    {
+        // libgit2 may not support everything git does (i.e. some index
+        // extensions), the git command may still work in that case
+        //
+        git_error const * e(git_error_last());
+        SNAP_LOG_WARNING
+            << "libgit2 could not inspect \""
+            << path
+            << "\" ("
+            << (e == nullptr ? "unknown error" : e->message)
+            << "); falling back to the git command."
+            << SNAP_LOG_SEND;
+        status = repository_status();
+        return f_fallback.inspect(path, status);
+    }
+    return true;
+}
+
+
+bool libgit2_repository_inspector::inspect_repository(git_repository * repo, repository_status & status)
+{
+    // HEAD
+    //
+    git_reference * head(nullptr);
+    if(git_repository_head(&head, repo) != 0)
+    {
+        return false;
+    }
+    git_oid const * head_oid(git_reference_target(head));
+    if(head_oid == nullptr)
+    {
+        git_reference_free(head);
+        return false;
+    }
+    status.set_head(oid_to_string(head_oid));
+    status.set_branch(git_reference_is_branch(head)
+                ? git_reference_shorthand(head)
+                : "(detached)");
+
+    // upstream & ahead/behind
+    //
+    git_reference * upstream(nullptr);
+    if(git_reference_is_branch(head)
+    && git_branch_upstream(&upstream, head) == 0)
+    {
+        status.set_upstream(git_reference_shorthand(upstream));
+        git_oid const * upstream_oid(git_reference_target(upstream));
+        std::size_t ahead(0);
+        std::size_t behind(0);
+        if(upstream_oid != nullptr
+        && git_graph_ahead_behind(&ahead, &behind, repo, head_oid, upstream_oid) == 0)
+        {
+            status.set_ahead_behind(ahead, behind);
+        }
+        git_reference_free(upstream);
+    }
+
+    // last commit
+    //
+    git_commit * commit(nullptr);
+    if(git_commit_lookup(&commit, repo, head_oid) == 0)
+    {
+        status.set_last_commit(status.get_head(), git_commit_time(commit));
+        git_commit_free(commit);
+    }
+    git_reference_free(head);
+
+    // changes (untracked files are ignored, like `git diff-index HEAD`)
+    //
+    git_status_options options = GIT_STATUS_OPTIONS_INIT;
+    options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+    options.flags = 0;
+    git_status_list * list(nullptr);
+    if(git_status_list_new(&list, repo, &options) != 0)
+    {
+        return false;
+    }
+    status.set_changes(git_status_list_entrycount(list));
+    git_status_list_free(list);
+
+    return !status.get_last_commit_hash().empty();
+}
+
+
+bool libgit2_repository_inspector::is_in_process() const
+{
+    return true;
+}
+
+
+
+} // no name namespace
+#endif
+
+
+
+repository_inspector::~repository_inspector()
+{
+}
+
+
+/** \brief Get the repository inspector.
+ *
+ * This function returns the libgit2 inspector when available and the
+ * shell inspector otherwise.
+ *
+ * \return The repository inspector.
+ */
+repository_inspector::pointer_t repository_inspector::get_instance()
+{
+#ifdef HAVE_LIBGIT2
+    static pointer_t g_inspector(std::make_shared<libgit2_repository_inspector>());
+#else
+    static pointer_t g_inspector(std::make_shared<shell_repository_inspector>());
+#endif
+    return g_inspector;
+}
+
+
+/** \brief Inspect a repository by running git.
+ *
+ * This function runs the same two git commands as the asynchronous
+ * local probes and parses their output.
+ *
+ * \param[in] path  The path to the repository.
+ * \param[out] status  The status to fill.
+ *
+ * \return true if the status is valid.
+ */
+bool shell_repository_inspector::inspect(std::string const & path, repository_status & status)
+{
+    status.parse_porcelain(run(path, "git --no-optional-locks status --porcelain=v2 --branch --untracked-files=no"));
+    return status.parse_last_commit(run(path, "git log -1 --format=%H%x00%ct"));
+}
+
+
+bool shell_repository_inspector::is_in_process() const
+{
+    return false;
+}
+
+
+std::string shell_repository_inspector::run(std::string const & path, std::string const & command)
+{
+    std::string cmd("cd ");
+    cmd += path;
+    cmd += "; ";
+    cmd += command;
+
+    SNAP_LOG_TRACE
+        << "inspect repository with: "
+        << cmd
+        << SNAP_LOG_SEND;
+
+    std::string output;
+    FILE * p(popen(cmd.c_str(), "r"));
+    if(p == nullptr)
+    {
+        return output;
+    }
+    char buf[4096];
+    for(;;)
+    {
+        std::size_t const size(fread(buf, 1, sizeof(buf), p));
+        if(size == 0)
+        {
+            break;
+        }
+        output.append(buf, size);
+    }
+    pclose(p);
+
+    return output;
+}
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,139 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+// C++
+//
+#include    <ctime>
+#include    <memory>
+#include    <string>
+
+
+
+namespace builder
+{
+
+
+
+std::string                     get_git_dir(std::string const & project_path);
+
+
+/** \brief The status of a git repository.
+ *
+ * This class gathers the local status of a project repository from the
+ * output of two git commands:
+ *
+ * \code
+ *     git --no-optional-locks status --porcelain=v2 --branch --untracked-files=no
+ *     git log -1 --format=%H%x00%ct
+ * \endcode
+ *
+ * The first gives us the HEAD commit, the upstream branch, the ahead and
+ * behind counters and the list of changed files. The --no-optional-locks
+ * prevents git from refreshing the index, which would otherwise trigger
+ * the project_watcher. The --untracked-files=no avoids scanning for
+ * untracked files which are not counted as changes anyway. The second
+ * gives us the hash and timestamp of the last commit.
+ *
+ * From that information we compute whether the project was committed and
+ * pushed.
+ */
+class repository_status
+{
+public:
+    typedef std::shared_ptr<repository_status>  pointer_t;
+
+    bool                        parse_porcelain(std::string const & output);
+    bool                        parse_last_commit(std::string const & output);
+
+    void                        set_head(std::string const & head);
+    void                        set_branch(std::string const & branch);
+    void                        set_upstream(std::string const & upstream);
+    void                        set_ahead_behind(int ahead, int behind);
+    void                        set_changes(std::size_t changes);
+    void                        set_last_commit(std::string const & hash, time_t timestamp);
+
+    std::string const &         get_head() const;
+    std::string const &         get_branch() const;
+    std::string const &         get_upstream() const;
+    int                         get_ahead() const;
+    int                         get_behind() const;
+    std::size_t                 get_changes() const;
+    std::string const &         get_last_commit_hash() const;
+    time_t                      get_last_commit() const;
+
+    bool                        is_committed() const;
+    bool                        is_pushed() const;
+    std::string                 get_state() const;
+
+private:
+    std::string                 f_head = std::string();
+    std::string                 f_branch = std::string();
+    std::string                 f_upstream = std::string();
+    int                         f_ahead = 0;
+    int                         f_behind = 0;
+    std::size_t                 f_changes = 0;
+    std::string                 f_last_commit_hash = std::string();
+    time_t                      f_last_commit = 0;
+};
+
+
+
+/** \brief Interface used to inspect a repository.
+ *
+ * The inspector fills a repository_status object. There are two
+ * implementations:
+ *
+ * * shell -- run the git commands and parse their output; this is the
+ * fallback, always available
+ * * libgit2 -- when compiled with libgit2 (HAVE_LIBGIT2), read the
+ * repository directly without starting any process; if libgit2 fails
+ * to open a repository, the shell implementation is used instead
+ *
+ * The inspect() function is thread safe.
+ */
+class repository_inspector
+{
+public:
+    typedef std::shared_ptr<repository_inspector>   pointer_t;
+
+    virtual                     ~repository_inspector();
+
+    virtual bool                inspect(std::string const & path, repository_status & status) = 0;
+    virtual bool                is_in_process() const = 0;
+
+    static pointer_t            get_instance();
+};
+
+
+class shell_repository_inspector
+    : public repository_inspector
+{
+public:
+    virtual bool                inspect(std::string const & path, repository_status & status) override;
+    virtual bool                is_in_process() const override;
+
+private:
+    static std::string          run(std::string const & path, std::string const & command);
+};
+
+
+
+} // builder namespace
+// vim: ts=4 sw=4 et
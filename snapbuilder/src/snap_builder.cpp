@@ -22,6 +22,7 @@
 #include    "snap_builder.h"
 
 #include    "about_dialog.h"
+#include    "changelog.h"
 #include    "project.h"
 #include    "version.h"
 
@@ -64,11 +65,13 @@
 
 // C++
 //
+#include    <algorithm>
 #include    <fstream>
 
 
 // C
 //
+#include    <curl/curl.h>
 #include    <stdlib.h>
 #include    <sys/stat.h>
 #include    <unistd.h>
@@ -106,6 +109,40 @@ const advgetopt::option g_options[] =
       , advgetopt::DefaultValue("https://api.launchpad.net/devel/~snapcpp/+archive/ubuntu/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=@PROJECT_NAME@")
       , advgetopt::Help("URL used to get the status of a project on launchpad.")
     ),
+    advgetopt::define_option(
+        advgetopt::Name("deb-url")
+      , advgetopt::Flags(advgetopt::any_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+          , advgetopt::GETOPT_FLAG_COMMAND_LINE
+          , advgetopt::GETOPT_FLAG_ENVIRONMENT_VARIABLE
+          , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
+      , advgetopt::DefaultValue("https://launchpad.net/~snapcpp/+archive/ubuntu/ppa/+files/")
+      , advgetopt::Help("URL of the folder where launchpad publishes the .deb files of the PPA; the name of the .deb is appended to it.")
+    ),
+    advgetopt::define_option(
+        advgetopt::Name("keep-ppa-json")
+      , advgetopt::Flags(advgetopt::standalone_all_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+      , advgetopt::Help("Keep the JSON files downloaded from launchpad in the cache (for debugging); by default only the binary records are kept.")
+    ),
+    advgetopt::define_option(
+        advgetopt::Name("sweep-url")
+      , advgetopt::Flags(advgetopt::any_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+          , advgetopt::GETOPT_FLAG_COMMAND_LINE
+          , advgetopt::GETOPT_FLAG_ENVIRONMENT_VARIABLE
+          , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
+      , advgetopt::Help("URL used to get the latest build records of the whole PPA at once while watching builds; if not defined, each project is checked with the launchpad-url.")
+    ),
+    advgetopt::define_option(
+        advgetopt::Name("packages-url")
+      , advgetopt::Flags(advgetopt::any_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+          , advgetopt::GETOPT_FLAG_COMMAND_LINE
+          , advgetopt::GETOPT_FLAG_ENVIRONMENT_VARIABLE
+          , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
+      , advgetopt::Help("URL of the Packages.gz index used to verify that the .deb files were published; if not defined, each .deb is checked with a HEAD request.")
+    ),
     advgetopt::define_option(
         advgetopt::Name("release-names")
       , advgetopt::Flags(advgetopt::any_flags<
@@ -115,6 +152,26 @@ const advgetopt::option g_options[] =
           , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
       , advgetopt::Help("Select a list of releases that are being built (xenial, bionic, etc) separated by commas.")
     ),
+    advgetopt::define_option(
+        advgetopt::Name("worker-threads")
+      , advgetopt::Flags(advgetopt::any_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+          , advgetopt::GETOPT_FLAG_COMMAND_LINE
+          , advgetopt::GETOPT_FLAG_ENVIRONMENT_VARIABLE
+          , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
+      , advgetopt::DefaultValue("4")
+      , advgetopt::Help("Number of background threads used to load and watch projects in parallel.")
+    ),
+    advgetopt::define_option(
+        advgetopt::Name("http-connections")
+      , advgetopt::Flags(advgetopt::any_flags<
+            advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+          , advgetopt::GETOPT_FLAG_COMMAND_LINE
+          , advgetopt::GETOPT_FLAG_ENVIRONMENT_VARIABLE
+          , advgetopt::GETOPT_FLAG_CONFIGURATION_FILE>())
+      , advgetopt::DefaultValue("8")
+      , advgetopt::Help("Maximum number of simultaneous connections used to download the PPA statuses.")
+    ),
     advgetopt::end_options()
 };
 
@@ -212,9 +269,25 @@ snap_builder::snap_builder(int argc, char * argv[])
     f_qt_connection = std::make_shared<ed::qt_connection>();
     f_communicator->add_connection(f_qt_connection);
 
-    f_background_worker = std::make_shared<background_worker>();
-    f_worker_thread = std::make_shared<cppthread::thread>("worker_thread", f_background_worker);
-    f_worker_thread->start();
+    f_project_watcher = std::make_shared<project_watcher>(this);
+    f_communicator->add_connection(f_project_watcher);
+
+    // the workers use curl in parallel and the global initialization
+    // is not thread safe in older versions so do it once now
+    //
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    long const http_connections(std::clamp(f_opt.get_long("http-connections"), 1L, 64L));
+    f_remote_health = std::make_shared<remote_health>();
+    f_http_client = std::make_shared<http_client>(http_connections);
+    f_http_client->set_remote_health(f_remote_health);
+    f_http_client->start();
+
+    f_package_index = std::make_shared<package_index>(this);
+
+    long const worker_threads(std::clamp(f_opt.get_long("worker-threads"), 1L, 64L));
+    f_background_worker = std::make_shared<background_worker>(worker_threads);
+    f_background_worker->start();
 
     setupUi(this);
     f_table->horizontalHeader()->setStretchLastSection(true);
@@ -223,6 +296,9 @@ snap_builder::snap_builder(int argc, char * argv[])
 
     setWindowIcon(QIcon(":/icons/icon.png"));
 
+    f_job_statistics = new QLabel(this);
+    statusbar->addPermanentWidget(f_job_statistics);
+
     restoreGeometry(f_settings.value("geometry", saveGeometry()).toByteArray());
     restoreState(f_settings.value("state", saveState()).toByteArray());
 
@@ -279,7 +355,25 @@ snap_builder::snap_builder(int argc, char * argv[])
     f_lockfile = std::make_shared<snapdev::lockfile>(f_cache_path + "/snap_builder.lock", snapdev::operation_t::OPERATION_EXCLUSIVE);
     f_lockfile->lock();
 
+    f_poll_scheduler = std::make_shared<poll_scheduler>(this);
+
     f_launchpad_url = f_opt.get_string("launchpad-url");
+    f_deb_url = f_opt.get_string("deb-url");
+    f_keep_ppa_json = f_opt.is_defined("keep-ppa-json");
+    if(f_opt.is_defined("sweep-url"))
+    {
+        f_sweep_url = f_opt.get_string("sweep-url");
+        f_build_sweep = std::make_shared<build_sweep>(this);
+    }
+    if(f_opt.is_defined("packages-url"))
+    {
+        f_packages_url = f_opt.get_string("packages-url");
+    }
+
+    // show the table as it was when we last closed snapbuilder until
+    // the background refresh replaces the stale rows
+    //
+    load_table_snapshot();
 
     // TODO: do that after n secs. so the UI is up
     //
@@ -292,6 +386,11 @@ snap_builder::snap_builder(int argc, char * argv[])
     // the timer is now in the background_processing job processor
     //f_timer_id = startTimer(1000 * 60); // 1 minute interval
 
+    // this timer is used to show the background job statistics and
+    // reload the projects which changed locally
+    //
+    f_timer_id = startTimer(1000);
+
     connect(this, &snap_builder::projectChanged, this, &snap_builder::on_project_changed);
     connect(this, &snap_builder::adjustColumns, this, &snap_builder::on_adjust_columns);
     connect(this, &snap_builder::gitPush, this, &snap_builder::on_git_push);
@@ -351,12 +450,66 @@ std::string const & snap_builder::get_cache_path() const
 }
 
 
+http_client::pointer_t snap_builder::get_http_client() const
+{
+    return f_http_client;
+}
+
+
+remote_health::pointer_t snap_builder::get_remote_health() const
+{
+    return f_remote_health;
+}
+
+
 std::string const & snap_builder::get_launchpad_url() const
 {
     return f_launchpad_url;
 }
 
 
+std::string const & snap_builder::get_deb_url() const
+{
+    return f_deb_url;
+}
+
+
+std::string const & snap_builder::get_sweep_url() const
+{
+    return f_sweep_url;
+}
+
+
+bool snap_builder::get_keep_ppa_json() const
+{
+    return f_keep_ppa_json;
+}
+
+
+build_sweep::pointer_t snap_builder::get_build_sweep() const
+{
+    return f_build_sweep;
+}
+
+
+std::string const & snap_builder::get_packages_url() const
+{
+    return f_packages_url;
+}
+
+
+package_index::pointer_t snap_builder::get_package_index() const
+{
+    return f_package_index;
+}
+
+
+poll_scheduler::pointer_t snap_builder::get_poll_scheduler() const
+{
+    return f_poll_scheduler;
+}
+
+
 advgetopt::string_list_t const & snap_builder::get_release_names() const
 {
     return f_release_names;
@@ -370,19 +523,87 @@ void snap_builder::closeEvent(QCloseEvent * event)
     f_communicator->remove_connection(f_qt_connection);
     f_qt_connection.reset();
 
+    f_project_watcher->clear();
+    f_communicator->remove_connection(f_project_watcher);
+
+    // stop the HTTP client first: it fails all the pending transfers
+    // which wakes up the workers waiting on a download or a HEAD
+    //
+    f_http_client->stop();
     f_background_worker->stop();
-    f_worker_thread->stop();
+
+    save_table_snapshot();
 
     f_settings.setValue("geometry", saveGeometry());
     f_settings.setValue("state", saveState());
 }
 
 
-void snap_builder::project_changed(project::pointer_t p)
+void snap_builder::timerEvent(QTimerEvent * event)
+{
+    if(event->timerId() != f_timer_id)
+    {
+        QMainWindow::timerEvent(event);
+        return;
+    }
+
+    background_worker::statistics_t const stats(f_background_worker->get_statistics());
+    http_client::statistics_t const http_stats(f_http_client->get_statistics());
+    QString status(
+            QString("Jobs: %1 queued, %2 running, %3 delayed, %4 merged, %5 cancelled"
+                    " | HTTP: %6 requests, %7 connections, %8 handshakes saved")
+                .arg(stats.f_queued)
+                .arg(stats.f_running)
+                .arg(stats.f_delayed)
+                .arg(stats.f_merged)
+                .arg(stats.f_cancelled)
+                .arg(http_stats.f_requests)
+                .arg(http_stats.f_new_connections)
+                .arg(http_stats.f_handshakes_saved));
+    if(f_remote_health->get_state() != remote_health::state_t::STATE_CLOSED)
+    {
+        status += QString(" | launchpad unavailable, next attempt in %1s")
+                        .arg(f_remote_health->get_pause());
+    }
+    f_job_statistics->setText(status);
+
+    // reload the projects which changed locally since the last tick
+    //
+    project::map_t reload;
+    reload.swap(f_reload_pending);
+    for(auto const & p : reload)
+    {
+        load_project(p.second, job::priority_t::PRIORITY_LOCAL_REFRESH);
+    }
+}
+
+
+/** \brief Schedule the reload of a project which changed locally.
+ *
+ * The project_watcher calls this function each time one of the watched
+ * files of a project changes. Git generally modifies several files for
+ * one command, so the project is only marked here and actually reloaded
+ * on the next tick of the timer. This way one reload handles all the
+ * events received in between.
+ *
+ * \param[in] p  The project that changed.
+ */
+void snap_builder::project_files_changed(project::pointer_t p)
+{
+    f_reload_pending[p->get_name()] = p;
+}
+
+
+/** \brief Send the projectChanged signal.
+ *
+ * \param[in] p  The project that changed.
+ * \param[in] columns  The mask of the columns that changed.
+ */
+void snap_builder::project_changed(project::pointer_t p, column_mask_t columns)
 {
     project_ptr ptr;
     ptr.f_ptr = p;
-    emit projectChanged(ptr);
+    emit projectChanged(ptr, columns);
 }
 
 
@@ -418,7 +639,15 @@ int snap_builder::find_row(project::pointer_t p) const
 }
 
 
-void snap_builder::on_project_changed(project_ptr p)
+/** \brief Update the row of a project which changed.
+ *
+ * Only the cells of the \p columns that changed get updated. The row
+ * color and the SVG graph are only updated if the state color changed.
+ *
+ * \param[in] p  The project that changed.
+ * \param[in] columns  The mask of the columns that changed.
+ */
+void snap_builder::on_project_changed(project_ptr p, quint32 columns)
 {
     int const row(find_row(p.f_ptr));
     if(row < 0)
@@ -426,27 +655,54 @@ void snap_builder::on_project_changed(project_ptr p)
         return;
     }
 
-    QTableWidgetItem * item(f_table->item(row, COLUMN_CURRENT_VERSION));
-    item->setText(QString::fromUtf8(p.f_ptr->get_version().c_str()));
+    mark_row_stale(row, false);
 
-    item = f_table->item(row, COLUMN_LAUNCHPAD_VERSION);
-    item->setText(QString::fromUtf8(p.f_ptr->get_remote_version().c_str()));
+    if((columns & column_mask(COLUMN_CURRENT_VERSION)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_CURRENT_VERSION));
+        item->setText(QString::fromUtf8(p.f_ptr->get_version().c_str()));
+    }
+
+    if((columns & column_mask(COLUMN_LAUNCHPAD_VERSION)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_LAUNCHPAD_VERSION));
+        item->setText(QString::fromUtf8(p.f_ptr->get_remote_version().c_str()));
+    }
 
-    item = f_table->item(row, COLUMN_CHANGES);
-    item->setText(QString::fromUtf8(p.f_ptr->get_state().c_str()));
+    if((columns & column_mask(COLUMN_CHANGES)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_CHANGES));
+        item->setText(QString::fromUtf8(p.f_ptr->get_state().c_str()));
+    }
 
-    item = f_table->item(row, COLUMN_LOCAL_CHANGES_DATE);
-    item->setText(QString::fromUtf8(p.f_ptr->get_last_commit_as_string().c_str()));
+    if((columns & column_mask(COLUMN_LOCAL_CHANGES_DATE)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_LOCAL_CHANGES_DATE));
+        item->setText(QString::fromUtf8(p.f_ptr->get_last_commit_as_string().c_str()));
+    }
 
-    item = f_table->item(row, COLUMN_BUILD_STATE);
-    item->setText(QString::fromUtf8(p.f_ptr->get_remote_build_state().c_str()));
+    if((columns & column_mask(COLUMN_BUILD_STATE)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_BUILD_STATE));
+        item->setText(QString::fromUtf8(p.f_ptr->get_remote_build_state().c_str()));
+        item->setToolTip(QString::fromUtf8(p.f_ptr->get_build_log_excerpt().c_str()));
+    }
 
-    item = f_table->item(row, COLUMN_LAUNCHPAD_COMPILED_DATE);
-    item->setText(QString::fromUtf8(p.f_ptr->get_remote_build_date().c_str()));
+    if((columns & column_mask(COLUMN_LAUNCHPAD_COMPILED_DATE)) != 0)
+    {
+        QTableWidgetItem * item(f_table->item(row, COLUMN_LAUNCHPAD_COMPILED_DATE));
+        item->setText(QString::fromUtf8(p.f_ptr->get_remote_build_date().c_str()));
+    }
 
-    update_state(row);
     set_button_status();
 
+    if((columns & COLUMN_MASK_ROW_COLOR) == 0)
+    {
+        return;
+    }
+
+    update_state(row);
+
     if(f_auto_update_svg)
     {
         // at this time I simply regenerate the whole thing... it would be
@@ -532,6 +788,98 @@ void snap_builder::update_state(int row)
 }
 
 
+/** \brief Load the table as it was when snapbuilder was last closed.
+ *
+ * The snapshot is saved in the settings by save_table_snapshot(). It
+ * includes the text of each column and the color of each row. The
+ * read_list_of_projects() function uses it to fill the rows until the
+ * projects get loaded.
+ */
+void snap_builder::load_table_snapshot()
+{
+    f_table_snapshot.clear();
+
+    int const size(f_settings.beginReadArray("snapshot"));
+    for(int i(0); i < size; ++i)
+    {
+        f_settings.setArrayIndex(i);
+        row_snapshot_t row;
+        row.f_columns = f_settings.value("columns").toStringList();
+        row.f_color = f_settings.value("color").value<QColor>();
+        if(row.f_columns.size() == COLUMN_max)
+        {
+            f_table_snapshot[row.f_columns[COLUMN_PROJECT_NAME]] = row;
+        }
+    }
+    f_settings.endArray();
+}
+
+
+void snap_builder::save_table_snapshot()
+{
+    int const max_rows(f_table->rowCount());
+    f_settings.beginWriteArray("snapshot", max_rows);
+    for(int row(0); row < max_rows; ++row)
+    {
+        f_settings.setArrayIndex(row);
+        QStringList columns;
+        for(int col(0); col < COLUMN_max; ++col)
+        {
+            QTableWidgetItem * item(f_table->item(row, col));
+            columns << (item == nullptr ? QString() : item->text());
+        }
+        f_settings.setValue("columns", columns);
+
+        // always write the color, the array keeps the keys of the previous
+        // save which may be the color of another project
+        //
+        QTableWidgetItem * item(f_table->item(row, COLUMN_PROJECT_NAME));
+        f_settings.setValue(
+                  "color"
+                , item == nullptr ? QColor() : item->background().color());
+    }
+    f_settings.endArray();
+}
+
+
+/** \brief Show whether a row represents stale data.
+ *
+ * The rows filled from the snapshot are shown in gray italic until
+ * the project gets loaded.
+ *
+ * \param[in] row  The row to change.
+ * \param[in] stale  Whether the row is stale.
+ */
+void snap_builder::mark_row_stale(int row, bool stale)
+{
+    QTableWidgetItem * name(f_table->item(row, COLUMN_PROJECT_NAME));
+    if(name == nullptr
+    || name->font().italic() == stale)
+    {
+        return;
+    }
+
+    int const max(f_table->columnCount());
+    for(int col(0); col < max; ++col)
+    {
+        QTableWidgetItem * cell(f_table->item(row, col));
+        QFont font(cell->font());
+        font.setItalic(stale);
+        cell->setFont(font);
+        if(stale)
+        {
+            cell->setForeground(QBrush(Qt::darkGray));
+            cell->setToolTip("Last known state, refreshing...");
+        }
+        else
+        {
+            cell->setData(Qt::ForegroundRole, QVariant());
+            cell->setToolTip(QString());
+        }
+    }
+}
+
+
 // TODO: implement a version where we only update one project, which would make
 //       it a lot faster
 //
@@ -567,6 +915,15 @@ void snap_builder::read_list_of_projects()
         f_current_project.reset();
     }
 
+    // the jobs still working on the old list of projects are now useless
+    //
+    if(f_generation != nullptr)
+    {
+        f_background_worker->cancel(f_generation);
+    }
+    f_generation = std::make_shared<cancel_token>();
+    f_reload_pending.clear();
+
     f_projects.clear();
 
     int line(1);
@@ -638,6 +995,17 @@ void snap_builder::read_list_of_projects()
     //
     f_auto_update_svg = false;
 
+    // the ADJUST COLUMNS job is a barrier which has to be sent after all
+    // the LOAD PROJECT jobs which themselves are sent once their local
+    // probes are done, so we count the probes still running
+    //
+    cancel_token::pointer_t generation(f_generation);
+    std::shared_ptr<int> remaining(std::make_shared<int>(count));
+    if(count == 0)
+    {
+        adjust_columns_once_loaded();
+    }
+
     QTableWidgetItem * item(nullptr);
     int row(0);
     int reselect_row(-1);
@@ -645,9 +1013,19 @@ void snap_builder::read_list_of_projects()
     {
         if(p->exists())
         {
-            job::pointer_t j(std::make_shared<job>(job::work_t::WORK_LOAD_PROJECT));
-            j->set_project(p);
-            f_background_worker->send_job(j);
+            p->prefetch_ppa_status();
+            load_project(
+                      p
+                    , job::priority_t::PRIORITY_BULK_LOAD
+                    , [this, generation, remaining]()
+                    {
+                        --*remaining;
+                        if(*remaining == 0
+                        && !generation->is_cancelled())
+                        {
+                            adjust_columns_once_loaded();
+                        }
+                    });
 
             project_ptr ptr({p});
             QVariant v(QVariant::fromValue(ptr));
@@ -688,15 +1066,34 @@ void snap_builder::read_list_of_projects()
 
             update_state(row);
 
+            // until loaded, show the last known state if available
+            //
+            auto const snapshot(f_table_snapshot.find(QString::fromUtf8(p->get_name().c_str())));
+            if(snapshot != f_table_snapshot.end())
+            {
+                for(int col(COLUMN_PROJECT_NAME + 1); col < COLUMN_max; ++col)
+                {
+                    f_table->item(row, col)->setText(snapshot->second.f_columns[col]);
+                }
+                QBrush const background(snapshot->second.f_color.isValid()
+                                            ? QBrush(snapshot->second.f_color)
+                                            : QBrush());
+                for(int col(0); col < COLUMN_max; ++col)
+                {
+                    f_table->item(row, col)->setBackground(background);
+                }
+                mark_row_stale(row, true);
+            }
+
             ++row;
         }
     }
 
-    {
-        job::pointer_t j(std::make_shared<job>(job::work_t::WORK_ADJUST_COLUMNS));
-        j->set_snap_builder(this);
-        f_background_worker->send_job(j);
-    }
+    f_project_watcher->watch_projects(f_projects);
+
+    // the snapshot is only useful on startup
+    //
+    f_table_snapshot.clear();
 
     if(reselect_row != -1)
     {
@@ -709,9 +1106,94 @@ void snap_builder::read_list_of_projects()
 }
 
 
+/** \brief Load a project.
+ *
+ * This function first runs the local probes of the project (git and dpkg
+ * commands) asynchronously. Once they are done, it sends the LOAD PROJECT
+ * job to the background workers, which then only have to handle the
+ * cache files and the remote data.
+ *
+ * On a bulk load, the probes are skipped if the cached local state of
+ * the project is still valid.
+ *
+ * If the list of projects gets reloaded before the probes are done, the
+ * job is not sent.
+ *
+ * \param[in] p  The project to load.
+ * \param[in] priority  The priority of the LOAD PROJECT job.
+ * \param[in] loaded  An optional callback called once the job was sent.
+ */
+void snap_builder::load_project(
+      project::pointer_t p
+    , job::priority_t priority
+    , local_probe::done_t loaded)
+{
+    // on a bulk load (i.e. startup) reuse the cached local state of
+    // the projects which did not change
+    //
+    if(priority == job::priority_t::PRIORITY_BULK_LOAD
+    && p->load_local_state())
+    {
+        job::pointer_t j(std::make_shared<job>(job::work_t::WORK_LOAD_PROJECT));
+        j->set_project(p);
+        j->set_priority(priority);
+        send_job(j);
+
+        if(loaded != nullptr)
+        {
+            loaded();
+        }
+        return;
+    }
+
+    cancel_token::pointer_t generation(f_generation);
+    p->start_local_probes([this, p, priority, loaded, generation]()
+        {
+            if(generation->is_cancelled())
+            {
+                return;
+            }
+
+            job::pointer_t j(std::make_shared<job>(job::work_t::WORK_LOAD_PROJECT));
+            j->set_project(p);
+            j->set_priority(priority);
+            send_job(j);
+
+            if(loaded != nullptr)
+            {
+                loaded();
+            }
+        });
+}
+
+
+void snap_builder::adjust_columns_once_loaded()
+{
+    job::pointer_t j(std::make_shared<job>(job::work_t::WORK_ADJUST_COLUMNS));
+    j->set_snap_builder(this);
+    j->set_priority(job::priority_t::PRIORITY_BULK_LOAD);
+    send_job(j);
+}
+
+
+/** \brief Send a job to the background workers.
+ *
+ * The job is attached to the current generation of the list of projects
+ * so it gets cancelled if the list is reloaded before the job is done.
+ *
+ * \param[in] j  The job to send.
+ */
+void snap_builder::send_job(job::pointer_t j)
+{
+    j->set_snap_builder(this);
+    j->set_cancel_token(f_generation);
+    f_background_worker->send_job(j);
+}
+
+
 bool snap_builder::is_background_thread() const
 {
-    return f_worker_thread->get_thread_tid() == cppthread::gettid();
+    return f_background_worker->is_worker_thread();
 }
 
 
@@ -764,9 +1246,7 @@ void snap_builder::on_local_refresh_clicked()
         return;
     }
 
-    job::pointer_t j(std::make_shared<job>(job::work_t::WORK_LOAD_PROJECT));
-    j->set_project(f_current_project);
-    f_background_worker->send_job(j);
+    load_project(f_current_project, job::priority_t::PRIORITY_INTERACTIVE);
 }
 
 
@@ -787,7 +1267,7 @@ void snap_builder::on_remote_refresh_clicked()
 
     job::pointer_t j(std::make_shared<job>(job::work_t::WORK_RETRIEVE_PPA_STATUS));
     j->set_project(f_current_project);
-    f_background_worker->send_job(j);
+    send_job(j);
 }
 
 
@@ -1256,22 +1736,36 @@ void snap_builder::on_bump_version_clicked()
             + '.'
             + numbers[3]);
 
+    // the new entry reuses the maintainer of the previous entry unless
+    // the user defined DEBFULLNAME & DEBEMAIL (as with dch)
+    //
     // TODO: offer the user to choose the email address
     //
-    setenv("DEBEMAIL", "alexis@m2osw.com", 0);
-
-    std::string cmd("cd ");
-    cmd += selection;
-    cmd += " && dch --newversion ";
-    cmd += new_version;
-    cmd += "~";
-    cmd += f_distribution;
-    cmd += " --urgency high --distribution ";
-    cmd += f_distribution;
-    cmd += " \"Bumped build version to rebuild on Launchpad.\"";
-    int r(system(cmd.c_str()));
-    if(r != 0)
+    std::string const filename(selection + "/debian/changelog");
+    changelog entry;
+    bool bumped(entry.read(filename));
+    if(bumped)
+    {
+        char const * name(getenv("DEBFULLNAME"));
+        char const * email(getenv("DEBEMAIL"));
+        if(name != nullptr
+        && email != nullptr)
+        {
+            entry.set_maintainer(std::string(name) + " <" + email + ">");
+        }
+        entry.set_version(new_version + '~' + f_distribution);
+        entry.set_distribution(f_distribution);
+        entry.set_urgency("high");
+        entry.set_changes({ "* Bumped build version to rebuild on Launchpad." });
+        entry.set_date(time(nullptr));
+        bumped = entry.prepend_entry(filename);
+    }
+    if(!bumped)
     {
+        SNAP_LOG_ERROR
+            << entry.get_error()
+            << SNAP_LOG_SEND;
+
         QMessageBox msg(
               QMessageBox::Critical
             , "Bump Version Failed"
@@ -1304,7 +1798,7 @@ void snap_builder::on_bump_version_clicked()
                 std::string cmd_commit("cd ");
                 cmd_commit += selection;
                 cmd_commit += " && git commit -m \"Bumped build version to rebuild on Launchpad.\" debian/changelog";
-                r = system(cmd_commit.c_str());
+                int const r(system(cmd_commit.c_str()));
                 if(r != 0)
                 {
                     QMessageBox msg(
@@ -1332,7 +1826,7 @@ void snap_builder::on_bump_version_clicked()
                     job::pointer_t j(std::make_shared<job>(job::work_t::WORK_GIT_PUSH));
                     j->set_project(f_current_project);
                     j->set_snap_builder(this);
-                    f_background_worker->send_job(j);
+                    send_job(j);
                 }
             }
         }
@@ -1554,21 +2048,11 @@ void snap_builder::on_build_package_clicked()
     }
 
     f_current_project->set_state("sending");
+    f_current_project->project_changed();
 
     job::pointer_t j(std::make_shared<job>(job::work_t::WORK_START_BUILD));
     j->set_project(f_current_project);
-    f_background_worker->send_job(j);
-
-    int const row(find_row(f_current_project));
-    if(row >= 0)
-    {
-        QTableWidgetItem * item(f_table->item(row, COLUMN_CHANGES));
-        item->setText("sending");
-
-        update_state(row);
-        set_button_status();
-        on_generate_dependency_svg_triggered();
-    }
+    send_job(j);
 
 #if 0
     std::string const selection(get_selection());
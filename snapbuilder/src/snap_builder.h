@@ -21,8 +21,12 @@
 // self
 //
 #include    "background_processing.h"
+#include    "build_sweep.h"
 #include    "ui_snap_builder-MainWindow.h"
+#include    "package_index.h"
+#include    "poll_scheduler.h"
 #include    "project.h"
+#include    "project_watcher.h"
 
 
 // eventdispatcher
@@ -31,11 +35,6 @@
 #include    <eventdispatcher/qt_connection.h>
 
 
-// cppthread
-//
-#include    <cppthread/thread.h>
-
-
 // advgetopt
 //
 #include    <advgetopt/advgetopt.h>
@@ -50,7 +49,11 @@
 // Qt
 //
 #include    <QCloseEvent>
+#include    <QColor>
+#include    <QLabel>
 #include    <QSettings>
+#include    <QStringList>
+#include    <QTimerEvent>
 
 
 
@@ -68,9 +71,25 @@ enum column_t : int
     COLUMN_LOCAL_CHANGES_DATE,
     COLUMN_BUILD_STATE,
     COLUMN_LAUNCHPAD_COMPILED_DATE,
+
+    COLUMN_max
 };
 
 
+// bit mask of the columns which changed; the extra bit is used for the
+// color of the row (which is also the color used in the SVG graph)
+//
+typedef std::uint32_t               column_mask_t;
+
+constexpr column_mask_t const       COLUMN_MASK_ROW_COLOR = 1U << COLUMN_max;
+constexpr column_mask_t const       COLUMN_MASK_ALL = (1U << (COLUMN_max + 1)) - 1;
+
+constexpr column_mask_t column_mask(column_t column)
+{
+    return 1U << column;
+}
+
+
 
 // the main object, which is also a Qt window
 //#pragma GCC diagnostic push
@@ -95,24 +114,34 @@ public:
     std::string const &             get_cache_path() const;
     std::string const &             get_flag_name(std::string const & project_name) const;
     std::string const &             get_launchpad_url() const;
+    http_client::pointer_t          get_http_client() const;
+    remote_health::pointer_t        get_remote_health() const;
+    std::string const &             get_deb_url() const;
+    std::string const &             get_sweep_url() const;
+    bool                            get_keep_ppa_json() const;
+    build_sweep::pointer_t          get_build_sweep() const;
+    std::string const &             get_packages_url() const;
+    package_index::pointer_t        get_package_index() const;
+    poll_scheduler::pointer_t       get_poll_scheduler() const;
     advgetopt::string_list_t const &get_release_names() const;
 
-    void                            project_changed(project::pointer_t p);
+    void                            project_changed(project::pointer_t p, column_mask_t columns);
+    void                            project_files_changed(project::pointer_t p);
     void                            process_git_push(project::pointer_t p);
     void                            adjust_columns();
     bool                            is_background_thread() const;
 
 protected:
     virtual void                    closeEvent(QCloseEvent * event) override;
-    //virtual void                    timerEvent(QTimerEvent *event) override;
+    virtual void                    timerEvent(QTimerEvent * event) override;
 
 signals:
-    void                            projectChanged(project_ptr p);
+    void                            projectChanged(project_ptr p, quint32 columns);
     void                            adjustColumns();
     void                            gitPush(project_ptr p);
 
 private slots:
-    void                            on_project_changed(project_ptr p);
+    void                            on_project_changed(project_ptr p, quint32 columns);
     void                            on_adjust_columns();
     void                            on_git_push(project_ptr p);
     void                            on_refresh_list_triggered();
@@ -141,8 +170,21 @@ private slots:
     void                            on_build_package_clicked();
 
 private:
+    struct row_snapshot_t
+    {
+        QStringList                 f_columns = QStringList();
+        QColor                      f_color = QColor();
+    };
+    typedef std::map<QString, row_snapshot_t>   row_snapshot_map_t;
+
     void                            get_system_distribution();
     void                            read_list_of_projects();
+    void                            load_project(
+                                          project::pointer_t p
+                                        , job::priority_t priority
+                                        , local_probe::done_t loaded = local_probe::done_t());
+    void                            adjust_columns_once_loaded();
+    void                            send_job(job::pointer_t j);
     std::string                     get_selection() const;
     std::string                     get_selection_with_path(std::string path = std::string()) const;
     void                            set_button_status();
@@ -151,6 +193,9 @@ private:
                                           cppprocess::io * output_pipe
                                         , cppprocess::done_reason_t reason);
     void                            update_state(int row);
+    void                            load_table_snapshot();
+    void                            save_table_snapshot();
+    void                            mark_row_stale(int row, bool stale);
     int                             find_row(project::pointer_t p) const;
 
     QSettings                       f_settings = QSettings();
@@ -161,16 +206,29 @@ private:
     std::string                     f_config_path = std::string();
     std::string                     f_cache_path = std::string();
     std::string                     f_launchpad_url = std::string();
+    std::string                     f_deb_url = std::string();
+    std::string                     f_sweep_url = std::string();
+    std::string                     f_packages_url = std::string();
+    bool                            f_keep_ppa_json = false;
     std::string                     f_distribution = std::string("noble");
     project::vector_t               f_projects = project::vector_t();
     project::pointer_t              f_current_project = project::pointer_t();
     advgetopt::string_list_t        f_release_names = advgetopt::string_list_t();
     int                             f_timer_id = 0;
+    QLabel *                        f_job_statistics = nullptr;
     std::shared_ptr<snapdev::lockfile>
                                     f_lockfile = std::shared_ptr<snapdev::lockfile>();
     bool                            f_auto_update_svg = false;
+    http_client::pointer_t          f_http_client = http_client::pointer_t();
+    remote_health::pointer_t        f_remote_health = remote_health::pointer_t();
+    package_index::pointer_t        f_package_index = package_index::pointer_t();
+    build_sweep::pointer_t          f_build_sweep = build_sweep::pointer_t();
+    poll_scheduler::pointer_t       f_poll_scheduler = poll_scheduler::pointer_t();
     background_worker::pointer_t    f_background_worker = background_worker::pointer_t();
-    cppthread::thread::pointer_t    f_worker_thread = cppthread::thread::pointer_t();
+    cancel_token::pointer_t         f_generation = cancel_token::pointer_t();
+    project_watcher::pointer_t      f_project_watcher = project_watcher::pointer_t();
+    project::map_t                  f_reload_pending = project::map_t();
+    row_snapshot_map_t              f_table_snapshot = row_snapshot_map_t();
 };
 //#pragma GCC diagnostic pop
 
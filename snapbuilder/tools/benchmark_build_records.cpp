@@ -0,0 +1,319 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Compare the speed of the build record extractor with as2js.
+ *
+ * This tool loads the specified getBuildRecords JSON files (i.e. the
+ * files found in ~/.cache/snapbuilder) with the streaming extractor
+ * and with the as2js tree, the way snapbuilder used to do it, and
+ * reports the time each one takes. It also verifies that both return
+ * the same records.
+ *
+ * To get a large file, use the --generate option:
+ *
+ * \code
+ *     snapbuilder-benchmark --generate 5000 /tmp/large.json
+ *     snapbuilder-benchmark --iterations 20 /tmp/large.json ~/.cache/snapbuilder/snapdev.json
+ * \endcode
+ *
+ * This is a development tool; it is not installed.
+ */
+
+// self
+//
+#include    "build_record.h"
+
+
+// as2js
+//
+#include    <as2js/json.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <chrono>
+#include    <fstream>
+#include    <iomanip>
+#include    <iostream>
+
+
+
+namespace
+{
+
+
+std::string get_string(
+      as2js::json::json_value::object_t const & fields
+    , char const * name)
+{
+    auto const it(fields.find(name));
+    if(it == fields.end()
+    || it->second->get_type() != as2js::json::json_value::type_t::JSON_TYPE_STRING)
+    {
+        return std::string();
+    }
+
+    return it->second->get_string();
+}
+
+
+/** \brief Load the records the way load_remote_data() used to do it.
+ *
+ * The whole file is loaded in an as2js tree and each entry object map
+ * gets copied before the fields are read.
+ */
+bool load_with_as2js(std::string const & filename, builder::build_record::vector_t & records)
+{
+    as2js::json json;
+    as2js::json::json_value::pointer_t root(json.load(filename));
+    if(root == nullptr
+    || root->get_type() != as2js::json::json_value::type_t::JSON_TYPE_OBJECT)
+    {
+        return false;
+    }
+
+    as2js::json::json_value::object_t const & top_fields(root->get_object());
+    auto const it(top_fields.find("entries"));
+    if(it == top_fields.cend()
+    || it->second->get_type() != as2js::json::json_value::type_t::JSON_TYPE_ARRAY)
+    {
+        return false;
+    }
+
+    for(as2js::json::json_value::pointer_t const & e : it->second->get_array())
+    {
+        if(e->get_type() != as2js::json::json_value::type_t::JSON_TYPE_OBJECT)
+        {
+            continue;
+        }
+        as2js::json::json_value::object_t build(e->get_object());
+
+        builder::build_record r;
+        r.f_source_package_name = get_string(build, "source_package_name");
+        r.f_source_package_version = get_string(build, "source_package_version");
+        r.f_arch_tag = get_string(build, "arch_tag");
+        r.f_buildstate = get_string(build, "buildstate");
+        r.f_datebuilt = get_string(build, "datebuilt");
+        r.f_date_started = get_string(build, "date_started");
+        r.f_datecreated = get_string(build, "datecreated");
+        r.f_self_link = get_string(build, "self_link");
+        r.f_build_log_url = get_string(build, "build_log_url");
+        records.push_back(r);
+    }
+
+    return true;
+}
+
+
+bool same_records(
+      builder::build_record::vector_t const & a
+    , builder::build_record::vector_t const & b)
+{
+    if(a.size() != b.size())
+    {
+        return false;
+    }
+    for(std::size_t idx(0); idx < a.size(); ++idx)
+    {
+        if(a[idx].f_source_package_name != b[idx].f_source_package_name
+        || a[idx].f_source_package_version != b[idx].f_source_package_version
+        || a[idx].f_arch_tag != b[idx].f_arch_tag
+        || a[idx].f_buildstate != b[idx].f_buildstate
+        || a[idx].f_datebuilt != b[idx].f_datebuilt
+        || a[idx].f_date_started != b[idx].f_date_started
+        || a[idx].f_datecreated != b[idx].f_datecreated
+        || a[idx].f_self_link != b[idx].f_self_link
+        || a[idx].f_build_log_url != b[idx].f_build_log_url)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** \brief Generate a file with \p count entries.
+ *
+ * The entries include all the fields Launchpad sends so the file is
+ * about the same size as a real response with that many entries.
+ */
+bool generate(std::size_t count, std::string const & filename)
+{
+    char const * const archs[] = { "amd64", "arm64", "armhf", "i386" };
+    char const * const codenames[] = { "focal", "jammy", "noble" };
+    char const * const states[] = { "Successfully built", "Failed to build", "Currently building", "Needs building" };
+
+    std::ofstream out(filename);
+    if(!out.is_open())
+    {
+        return false;
+    }
+
+    out << "{\n  \"start\": 0,\n  \"total_size\": " << count << ",\n  \"entries\": [";
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::string const arch(archs[idx % 4]);
+        std::string const codename(codenames[idx / 4 % 3]);
+        std::string const version("1.1." + std::to_string(idx / 12) + ".0~" + codename);
+        std::string const link("https://api.launchpad.net/devel/~snapcpp/+archive/ubuntu/ppa/+build/" + std::to_string(23000000 + idx));
+        out << (idx == 0 ? "\n" : ",\n")
+            << "    {\n"
+            << "      \"self_link\": \"" << link << "\",\n"
+            << "      \"web_link\": \"https://launchpad.net/~snapcpp/+archive/ubuntu/ppa/+build/" << 23000000 + idx << "\",\n"
+            << "      \"resource_type_link\": \"https://api.launchpad.net/devel/#build\",\n"
+            << "      \"datecreated\": \"2022-02-01T03:45:14.192170+00:00\",\n"
+            << "      \"date_started\": \"2022-02-01T03:45:28.563934+00:00\",\n"
+            << "      \"datebuilt\": \"2022-02-01T03:47:52.315429+00:00\",\n"
+            << "      \"duration\": \"0:02:23.751495\",\n"
+            << "      \"date_first_dispatched\": \"2022-02-01T03:45:28.563934+00:00\",\n"
+            << "      \"builder_link\": \"https://api.launchpad.net/devel/builders/lcy02-" << arch << "-024\",\n"
+            << "      \"buildstate\": \"" << states[idx % 4] << "\",\n"
+            << "      \"build_log_url\": \"https://launchpad.net/~snapcpp/+archive/ubuntu/ppa/+build/" << 23000000 + idx
+                        << "/+files/buildlog_ubuntu-" << codename << '-' << arch << ".snapdev_" << version << "_BUILDING.txt.gz\",\n"
+            << "      \"title\": \"" << arch << " build of snapdev " << version << " in ubuntu " << codename << " RELEASE\",\n"
+            << "      \"dependencies\": null,\n"
+            << "      \"can_be_rescored\": false,\n"
+            << "      \"can_be_retried\": false,\n"
+            << "      \"can_be_cancelled\": false,\n"
+            << "      \"archive_link\": \"https://api.launchpad.net/devel/~snapcpp/+archive/ubuntu/ppa\",\n"
+            << "      \"pocket\": \"Release\",\n"
+            << "      \"upload_log_url\": null,\n"
+            << "      \"distribution_link\": \"https://api.launchpad.net/devel/ubuntu\",\n"
+            << "      \"current_source_publication_link\": \"https://api.launchpad.net/devel/~snapcpp/+archive/ubuntu/ppa/+sourcepub/13252546\",\n"
+            << "      \"source_package_name\": \"snapdev\",\n"
+            << "      \"source_package_version\": \"" << version << "\",\n"
+            << "      \"arch_tag\": \"" << arch << "\",\n"
+            << "      \"score\": null,\n"
+            << "      \"external_dependencies\": null,\n"
+            << "      \"http_etag\": \"\\\"4ce4e2d7f6de3e5b8e6fba3d1bbd1b0c3e0a7f2a-b6e1c7a1\\\"\"\n"
+            << "    }";
+    }
+    out << "\n  ]\n}\n";
+
+    return true;
+}
+
+
+template<typename F>
+double measure(int iterations, F f)
+{
+    auto const start(std::chrono::steady_clock::now());
+    for(int i(0); i < iterations; ++i)
+    {
+        f();
+    }
+    std::chrono::duration<double, std::milli> const elapsed(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+
+void usage(char const * progname)
+{
+    std::cerr << "Usage: " << progname << " [--iterations <count>] <file.json> ...\n"
+              << "       " << progname << " --generate <entries> <file.json>\n";
+}
+
+
+} // no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    int iterations(10);
+    std::vector<std::string> filenames;
+    for(int i(1); i < argc; ++i)
+    {
+        std::string const arg(argv[i]);
+        if(arg == "--iterations" && i + 1 < argc)
+        {
+            ++i;
+            iterations = std::max(1, std::stoi(argv[i]));
+        }
+        else if(arg == "--generate" && i + 2 < argc)
+        {
+            std::size_t const count(std::stoul(argv[i + 1]));
+            if(!generate(count, argv[i + 2]))
+            {
+                std::cerr << "error: could not create \"" << argv[i + 2] << "\".\n";
+                return 1;
+            }
+            return 0;
+        }
+        else if(arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            filenames.push_back(arg);
+        }
+    }
+    if(filenames.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int exit_code(0);
+    std::cout << std::fixed << std::setprecision(3);
+    for(auto const & filename : filenames)
+    {
+        builder::build_record::vector_t tree_records;
+        builder::build_record::vector_t stream_records;
+        if(!load_with_as2js(filename, tree_records)
+        || !builder::load_build_records(filename, stream_records))
+        {
+            std::cerr << "error: could not load \"" << filename << "\".\n";
+            exit_code = 1;
+            continue;
+        }
+        if(!same_records(tree_records, stream_records))
+        {
+            std::cerr << "error: the records found in \"" << filename << "\" differ.\n";
+            exit_code = 1;
+            continue;
+        }
+
+        double const tree_ms(measure(iterations, [&filename]()
+            {
+                builder::build_record::vector_t records;
+                load_with_as2js(filename, records);
+            }));
+        double const stream_ms(measure(iterations, [&filename]()
+            {
+                builder::build_record::vector_t records;
+                builder::load_build_records(filename, records);
+            }));
+
+        std::cout << filename
+                  << ": " << stream_records.size() << " records"
+                  << ", as2js: " << tree_ms << " ms"
+                  << ", stream: " << stream_ms << " ms"
+                  << ", x" << std::setprecision(1) << (stream_ms > 0.0 ? tree_ms / stream_ms : 0.0)
+                  << std::setprecision(3) << '\n';
+    }
+
+    return exit_code;
+}
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,748 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Stand-in for Launchpad used to run snapbuilder offline.
+ *
+ * This tool is a tiny HTTP server which replays files recorded from
+ * Launchpad. It lets us run snapbuilder (and the benchmarks) against a
+ * well known set of build records, without any network access, and
+ * reproduce slow or failing servers on demand.
+ *
+ * The fixture directory includes one sub-directory per step:
+ *
+ * \code
+ *     fixtures/step-0/...
+ *     fixtures/step-1/...
+ *     fixtures/step-2/...
+ * \endcode
+ *
+ * Each step represents the state of the PPA at one point in time
+ * (i.e. "Currently building", then "Successfully built", then the .deb
+ * files get published). A file missing in a step is searched in the
+ * previous steps, so a step only needs to include the files which
+ * changed. The server starts with step 0 and moves to the next step
+ * every `--step-interval` seconds or each time `/_fixture/next` gets
+ * requested. `/_fixture/reset` goes back to step 0 and `/_fixture/stats`
+ * returns the current step and the request counters.
+ *
+ * The path of a request is used as is to find the file in the step
+ * directory. The getBuildRecords requests are mapped to one file per
+ * project and page:
+ *
+ * \code
+ *     /ppa?ws.op=getBuildRecords&source_name=snapdev&ws.start=0
+ *         -> step-<n>/ppa/getBuildRecords/snapdev-0.json
+ *     /ppa?ws.op=getBuildRecords&ws.size=50&ws.start=50
+ *         -> step-<n>/ppa/getBuildRecords/all-50.json
+ *     /+files/snapdev_1.1.34.0~jammy_amd64.deb
+ *         -> step-<n>/+files/snapdev_1.1.34.0~jammy_amd64.deb
+ * \endcode
+ *
+ * The .deb files can be empty; only their presence matters to the HEAD
+ * requests.
+ *
+ * A small set of fixtures is found in tools/fixtures. It follows one
+ * build of snapdev 1.1.34.0~jammy on amd64: in step-0 it is being
+ * built, in step-1 it was successfully built and in step-2 its .deb
+ * gets published. Each step also includes the matching page of the
+ * PPA sweep (all-0.json).
+ *
+ * Other files are recorded with curl, for example:
+ *
+ * \code
+ *     curl -o fixtures/step-0/ppa/getBuildRecords/snapdev-0.json \
+ *         'https://api.launchpad.net/devel/~snapcpp/+archive/ubuntu/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=snapdev'
+ * \endcode
+ *
+ * Then point snapbuilder to the server:
+ *
+ * \code
+ *     snapbuilder-fixture-server --fixtures tools/fixtures --port 8080 --latency 200 --error-rate 5 &
+ *     snapbuilder \
+ *         --launchpad-url 'http://127.0.0.1:8080/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=@PROJECT_NAME@' \
+ *         --sweep-url 'http://127.0.0.1:8080/ppa?ws.op=getBuildRecords&ws.size=50' \
+ *         --deb-url 'http://127.0.0.1:8080/+files/'
+ * \endcode
+ *
+ * The responses include an ETag and a Last-Modified header built from
+ * the file information and the server replies with 304 when the client
+ * sends matching validators, like Launchpad does.
+ *
+ * The fixture_test (tools/fixture_test.cpp) runs the snapbuilder
+ * requests against these fixtures; it is registered with CTest.
+ *
+ * This is a development tool; it is not installed.
+ */
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <chrono>
+#include    <cstring>
+#include    <iostream>
+#include    <map>
+#include    <mutex>
+#include    <random>
+#include    <sstream>
+#include    <string>
+#include    <thread>
+
+
+// C
+//
+#include    <arpa/inet.h>
+#include    <netinet/in.h>
+#include    <strings.h>
+#include    <sys/socket.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+struct options_t
+{
+    std::string             f_fixtures = std::string();
+    int                     f_port = 8080;
+    int                     f_latency = 0;          // in ms
+    int                     f_jitter = 0;           // in ms
+    int                     f_error_rate = 0;       // in %
+    int                     f_error_status = 503;
+    int                     f_step_interval = 0;    // in seconds, 0 = manual
+};
+
+
+struct statistics_t
+{
+    std::atomic<std::size_t>    f_requests = 0;
+    std::atomic<std::size_t>    f_not_found = 0;
+    std::atomic<std::size_t>    f_not_modified = 0;
+    std::atomic<std::size_t>    f_errors = 0;
+};
+
+
+options_t                   g_options = options_t();
+statistics_t                g_statistics;
+std::atomic<int>            g_step = 0;
+int                         g_step_count = 0;
+std::mutex                  g_random_mutex;
+std::mt19937                g_random(std::random_device{}());
+
+
+struct request_t
+{
+    std::string                         f_method = std::string();
+    std::string                         f_path = std::string();
+    std::map<std::string, std::string>  f_query = std::map<std::string, std::string>();
+    std::map<std::string, std::string>  f_headers = std::map<std::string, std::string>();
+    bool                                f_keep_alive = true;
+};
+
+
+struct response_t
+{
+    int                     f_status = 200;
+    std::string             f_content_type = "application/octet-stream";
+    std::string             f_etag = std::string();
+    std::string             f_last_modified = std::string();
+    std::string             f_body = std::string();
+};
+
+
+bool is_directory(std::string const & path)
+{
+    struct stat s;
+    return stat(path.c_str(), &s) == 0 && S_ISDIR(s.st_mode);
+}
+
+
+std::string step_directory(int step)
+{
+    return g_options.f_fixtures + "/step-" + std::to_string(step);
+}
+
+
+int random_number(int max)
+{
+    std::lock_guard<std::mutex> lock(g_random_mutex);
+    return std::uniform_int_distribution<int>(0, max)(g_random);
+}
+
+
+int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if(c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if(c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+
+/** \brief Decode the %XX escapes of a URL part.
+ *
+ * \return false if an escape is not followed by two hexadecimal digits.
+ */
+bool url_decode(std::string const & s, bool query, std::string & result)
+{
+    result.clear();
+    for(std::size_t idx(0); idx < s.length(); ++idx)
+    {
+        if(s[idx] == '%')
+        {
+            if(idx + 2 >= s.length())
+            {
+                return false;
+            }
+            int const hi(hex_digit(s[idx + 1]));
+            int const lo(hex_digit(s[idx + 2]));
+            if(hi < 0 || lo < 0)
+            {
+                return false;
+            }
+            result += static_cast<char>(hi * 16 + lo);
+            idx += 2;
+        }
+        else if(s[idx] == '+' && query)
+        {
+            result += ' ';
+        }
+        else
+        {
+            result += s[idx];
+        }
+    }
+    return true;
+}
+
+
+std::string http_date(time_t t)
+{
+    struct tm m;
+    gmtime_r(&t, &m);
+    char buf[64];
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &m);
+    return buf;
+}
+
+
+char const * status_message(int status)
+{
+    switch(status)
+    {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default:  return "Unknown";
+    }
+}
+
+
+/** \brief Parse the header of one request.
+ *
+ * The \p header parameter is everything up to the empty line. We only
+ * support GET and HEAD so there is never a body to read.
+ */
+bool parse_request(std::string const & header, request_t & request)
+{
+    std::istringstream in(header);
+    std::string line;
+    if(!std::getline(in, line))
+    {
+        return false;
+    }
+    if(!line.empty() && line.back() == '\r')
+    {
+        line.pop_back();
+    }
+    std::istringstream first(line);
+    std::string target;
+    std::string version;
+    first >> request.f_method >> target >> version;
+    if(request.f_method.empty()
+    || target.empty()
+    || target[0] != '/')
+    {
+        return false;
+    }
+    request.f_keep_alive = version != "HTTP/1.0";
+
+    std::string::size_type const pos(target.find('?'));
+    if(!url_decode(target.substr(0, pos), false, request.f_path))
+    {
+        return false;
+    }
+    if(pos != std::string::npos)
+    {
+        std::istringstream query(target.substr(pos + 1));
+        std::string param;
+        while(std::getline(query, param, '&'))
+        {
+            std::string::size_type const equal(param.find('='));
+            std::string name;
+            std::string value;
+            if(!url_decode(param.substr(0, equal), true, name)
+            || (equal != std::string::npos
+                && !url_decode(param.substr(equal + 1), true, value)))
+            {
+                return false;
+            }
+            request.f_query[name] = value;
+        }
+    }
+
+    while(std::getline(in, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        std::string::size_type const colon(line.find(':'));
+        if(colon == std::string::npos)
+        {
+            continue;
+        }
+        std::string name(line.substr(0, colon));
+        for(auto & c : name)
+        {
+            c = std::tolower(static_cast<unsigned char>(c));
+        }
+        std::string::size_type const start(line.find_first_not_of(' ', colon + 1));
+        request.f_headers[name] = start == std::string::npos ? std::string() : line.substr(start);
+    }
+
+    auto const connection(request.f_headers.find("connection"));
+    if(connection != request.f_headers.end())
+    {
+        if(strcasecmp(connection->second.c_str(), "close") == 0)
+        {
+            request.f_keep_alive = false;
+        }
+        else if(strcasecmp(connection->second.c_str(), "keep-alive") == 0)
+        {
+            request.f_keep_alive = true;
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Transform the request in a filename relative to a step.
+ *
+ * The getBuildRecords requests use the source_name and ws.start
+ * parameters to select the file. The other requests use the path as is.
+ */
+std::string get_relative_filename(request_t const & request)
+{
+    std::string filename(request.f_path.substr(1));
+
+    auto const op(request.f_query.find("ws.op"));
+    if(op != request.f_query.end())
+    {
+        auto const name(request.f_query.find("source_name"));
+        auto const start(request.f_query.find("ws.start"));
+        filename += '/';
+        filename += op->second;
+        filename += '/';
+        filename += name == request.f_query.end() ? std::string("all") : name->second;
+        filename += '-';
+        filename += start == request.f_query.end() ? std::string("0") : start->second;
+        filename += ".json";
+    }
+
+    return filename;
+}
+
+
+void handle_fixture_command(request_t const & request, response_t & response)
+{
+    std::string const command(request.f_path.substr(10));  // skip "/_fixture/"
+    if(command == "next")
+    {
+        int step(g_step);
+        while(step + 1 < g_step_count
+           && !g_step.compare_exchange_weak(step, step + 1))
+        {
+        }
+    }
+    else if(command == "reset")
+    {
+        g_step = 0;
+    }
+    else if(command != "stats")
+    {
+        response.f_status = 404;
+        return;
+    }
+
+    response.f_content_type = "text/plain";
+    response.f_body = "step: " + std::to_string(g_step) + '/' + std::to_string(g_step_count)
+                    + "\nrequests: " + std::to_string(g_statistics.f_requests)
+                    + "\nnot_found: " + std::to_string(g_statistics.f_not_found)
+                    + "\nnot_modified: " + std::to_string(g_statistics.f_not_modified)
+                    + "\nerrors: " + std::to_string(g_statistics.f_errors)
+                    + '\n';
+}
+
+
+void handle_request(request_t const & request, response_t & response)
+{
+    if(request.f_path.compare(0, 10, "/_fixture/") == 0)
+    {
+        handle_fixture_command(request, response);
+        return;
+    }
+
+    ++g_statistics.f_requests;
+
+    if(g_options.f_latency > 0 || g_options.f_jitter > 0)
+    {
+        int const delay(g_options.f_latency + random_number(g_options.f_jitter));
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    }
+
+    if(g_options.f_error_rate > 0
+    && random_number(99) < g_options.f_error_rate)
+    {
+        ++g_statistics.f_errors;
+        response.f_status = g_options.f_error_status;
+        return;
+    }
+
+    if(request.f_method != "GET"
+    && request.f_method != "HEAD")
+    {
+        response.f_status = 400;
+        return;
+    }
+
+    std::string const relative(get_relative_filename(request));
+    if(relative.find("..") != std::string::npos)
+    {
+        response.f_status = 400;
+        return;
+    }
+
+    // search the current step and then the previous ones
+    //
+    std::string filename;
+    struct stat s;
+    for(int step(g_step); step >= 0; --step)
+    {
+        std::string const f(step_directory(step) + '/' + relative);
+        if(stat(f.c_str(), &s) == 0 && S_ISREG(s.st_mode))
+        {
+            filename = f;
+            break;
+        }
+    }
+    if(filename.empty())
+    {
+        ++g_statistics.f_not_found;
+        response.f_status = 404;
+        return;
+    }
+
+    std::stringstream etag;
+    etag << '"' << std::hex << s.st_mtime << '-' << s.st_size << '-' << s.st_ino << '"';
+    response.f_etag = etag.str();
+    response.f_last_modified = http_date(s.st_mtime);
+    if(relative.length() > 5
+    && relative.compare(relative.length() - 5, 5, ".json") == 0)
+    {
+        response.f_content_type = "application/json";
+    }
+
+    auto const if_none_match(request.f_headers.find("if-none-match"));
+    auto const if_modified_since(request.f_headers.find("if-modified-since"));
+    if((if_none_match != request.f_headers.end() && if_none_match->second == response.f_etag)
+    || (if_none_match == request.f_headers.end()
+            && if_modified_since != request.f_headers.end()
+            && if_modified_since->second == response.f_last_modified))
+    {
+        ++g_statistics.f_not_modified;
+        response.f_status = 304;
+        return;
+    }
+
+    FILE * f(fopen(filename.c_str(), "rb"));
+    if(f == nullptr)
+    {
+        response.f_status = 500;
+        return;
+    }
+    response.f_body.resize(s.st_size);
+    std::size_t const size(fread(response.f_body.data(), 1, response.f_body.size(), f));
+    fclose(f);
+    response.f_body.resize(size);
+}
+
+
+bool send_all(int s, std::string const & data)
+{
+    std::size_t sent(0);
+    while(sent < data.length())
+    {
+        ssize_t const r(send(s, data.data() + sent, data.length() - sent, MSG_NOSIGNAL));
+        if(r <= 0)
+        {
+            return false;
+        }
+        sent += r;
+    }
+    return true;
+}
+
+
+/** \brief Serve the requests of one connection.
+ *
+ * The connections are kept alive so the client can reuse them like it
+ * does with Launchpad.
+ */
+void serve_connection(int s)
+{
+    std::string buffer;
+    char data[4096];
+    for(;;)
+    {
+        std::string::size_type end(buffer.find("\r\n\r\n"));
+        while(end == std::string::npos)
+        {
+            ssize_t const r(recv(s, data, sizeof(data), 0));
+            if(r <= 0)
+            {
+                close(s);
+                return;
+            }
+            buffer.append(data, r);
+            end = buffer.find("\r\n\r\n");
+        }
+        std::string const header(buffer.substr(0, end));
+        buffer.erase(0, end + 4);
+
+        request_t request;
+        response_t response;
+        if(!parse_request(header, request))
+        {
+            request.f_keep_alive = false;
+            response.f_status = 400;
+        }
+        else
+        {
+            handle_request(request, response);
+        }
+
+        std::string reply("HTTP/1.1 ");
+        reply += std::to_string(response.f_status);
+        reply += ' ';
+        reply += status_message(response.f_status);
+        reply += "\r\nServer: snapbuilder-fixture-server\r\n";
+        if(!response.f_etag.empty())
+        {
+            reply += "ETag: " + response.f_etag + "\r\n";
+            reply += "Last-Modified: " + response.f_last_modified + "\r\n";
+        }
+        if(response.f_status != 304)
+        {
+            reply += "Content-Type: " + response.f_content_type + "\r\n";
+            reply += "Content-Length: " + std::to_string(response.f_body.length()) + "\r\n";
+        }
+        reply += request.f_keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        reply += "\r\n";
+        if(request.f_method != "HEAD")
+        {
+            reply += response.f_body;
+        }
+
+        if(!send_all(s, reply)
+        || !request.f_keep_alive)
+        {
+            close(s);
+            return;
+        }
+    }
+}
+
+
+void usage(char const * progname)
+{
+    std::cerr << "Usage: " << progname << " --fixtures <dir> [options]\n"
+              << "  --port <port>             port to listen on (127.0.0.1, default 8080)\n"
+              << "  --latency <ms>            delay added to each response\n"
+              << "  --jitter <ms>             random delay added to the latency\n"
+              << "  --error-rate <percent>    percentage of requests failing\n"
+              << "  --error-status <code>     status of the failing requests (default 503)\n"
+              << "  --step-interval <seconds> move to the next step automatically\n"
+              << "\n"
+              << "A sample set of fixtures (one snapdev build going through the\n"
+              << "building, built and published steps) is found in tools/fixtures:\n"
+              << "  " << progname << " --fixtures tools/fixtures --step-interval 60\n"
+              << "  snapbuilder \\\n"
+              << "      --launchpad-url 'http://127.0.0.1:8080/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=@PROJECT_NAME@' \\\n"
+              << "      --sweep-url 'http://127.0.0.1:8080/ppa?ws.op=getBuildRecords&ws.size=50' \\\n"
+              << "      --deb-url 'http://127.0.0.1:8080/+files/'\n";
+}
+
+
+} // no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    for(int i(1); i < argc; ++i)
+    {
+        std::string const arg(argv[i]);
+        if(arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        if(i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        ++i;
+        if(arg == "--fixtures")
+        {
+            g_options.f_fixtures = argv[i];
+        }
+        else if(arg == "--port")
+        {
+            g_options.f_port = std::stoi(argv[i]);
+        }
+        else if(arg == "--latency")
+        {
+            g_options.f_latency = std::max(0, std::stoi(argv[i]));
+        }
+        else if(arg == "--jitter")
+        {
+            g_options.f_jitter = std::max(0, std::stoi(argv[i]));
+        }
+        else if(arg == "--error-rate")
+        {
+            g_options.f_error_rate = std::clamp(std::stoi(argv[i]), 0, 100);
+        }
+        else if(arg == "--error-status")
+        {
+            g_options.f_error_status = std::stoi(argv[i]);
+        }
+        else if(arg == "--step-interval")
+        {
+            g_options.f_step_interval = std::max(0, std::stoi(argv[i]));
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    while(is_directory(step_directory(g_step_count)))
+    {
+        ++g_step_count;
+    }
+    if(g_step_count == 0)
+    {
+        std::cerr << "error: no \"step-0\" directory found in \"" << g_options.f_fixtures << "\".\n";
+        return 1;
+    }
+
+    int const s(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if(s < 0)
+    {
+        std::cerr << "error: could not create socket.\n";
+        return 1;
+    }
+    int const optval(1);
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(g_options.f_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+    || listen(s, 64) != 0)
+    {
+        std::cerr << "error: could not listen on 127.0.0.1:" << g_options.f_port << ".\n";
+        close(s);
+        return 1;
+    }
+
+    if(g_options.f_step_interval > 0)
+    {
+        std::thread([]()
+            {
+                for(;;)
+                {
+                    std::this_thread::sleep_for(std::chrono::seconds(g_options.f_step_interval));
+                    int const step(g_step);
+                    if(step + 1 >= g_step_count)
+                    {
+                        break;
+                    }
+                    g_step = step + 1;
+                    std::cout << "moved to step " << step + 1 << ".\n";
+                }
+            }).detach();
+    }
+
+    std::cout << "serving " << g_step_count
+              << " steps from \"" << g_options.f_fixtures
+              << "\" on http://127.0.0.1:" << g_options.f_port << "/\n";
+
+    for(;;)
+    {
+        int const c(accept4(s, nullptr, nullptr, SOCK_CLOEXEC));
+        if(c < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "error: accept() failed.\n";
+            break;
+        }
+        std::thread(serve_connection, c).detach();
+    }
+
+    close(s);
+    return 1;
+}
+
+// vim: ts=4 sw=4 et
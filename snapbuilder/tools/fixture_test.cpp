@@ -0,0 +1,393 @@
+// Copyright (c) 2021-2023  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapbuilder
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/** \file
+ * \brief Run the launchpad requests of snapbuilder against the fixtures.
+ *
+ * This test starts the fixture server on the fixtures found in
+ * tools/fixtures and sends the same requests as snapbuilder:
+ *
+ * * the getBuildRecords of one project (retrieve_ppa_status()),
+ * * the getBuildRecords of the whole PPA (the build sweep),
+ * * the HEAD of the .deb file (dot_deb_exists()).
+ *
+ * It moves the server through its steps and verifies the building ->
+ * built -> published transitions. A second run uses a server which
+ * always answers with a 503 and verifies that the remote health opens
+ * the circuit.
+ *
+ * \code
+ *     snapbuilder-fixture-test <fixture-server> <fixtures-dir>
+ * \endcode
+ *
+ * The test is registered with CTest.
+ */
+
+// self
+//
+#include    "build_record.h"
+#include    "http_client.h"
+#include    "remote_health.h"
+
+
+// C++
+//
+#include    <chrono>
+#include    <iostream>
+#include    <string>
+#include    <thread>
+#include    <vector>
+
+
+// C
+//
+#include    <arpa/inet.h>
+#include    <netinet/in.h>
+#include    <signal.h>
+#include    <stdlib.h>
+#include    <sys/socket.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+char const *            g_project_name = "snapdev";
+char const *            g_deb_name = "snapdev_1.1.34.0~jammy_amd64.deb";
+
+int                     g_errors = 0;
+
+
+void check(bool valid, std::string const & what)
+{
+    std::cout << (valid ? "ok:     " : "FAILED: ") << what << '\n';
+    if(!valid)
+    {
+        ++g_errors;
+    }
+}
+
+
+/** \brief Get a port nobody listens on.
+ *
+ * The kernel picks the port; it is released right away and given to
+ * the fixture server.
+ */
+int get_free_port()
+{
+    int const s(socket(AF_INET, SOCK_STREAM, 0));
+    if(s < 0)
+    {
+        return -1;
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len(sizeof(addr));
+    int port(-1);
+    if(bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0
+    && getsockname(s, reinterpret_cast<sockaddr *>(&addr), &len) == 0)
+    {
+        port = ntohs(addr.sin_port);
+    }
+    close(s);
+    return port;
+}
+
+
+bool can_connect(int port)
+{
+    int const s(socket(AF_INET, SOCK_STREAM, 0));
+    if(s < 0)
+    {
+        return false;
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bool const result(connect(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    close(s);
+    return result;
+}
+
+
+/** \brief A fixture server running in a child process.
+ *
+ * The server gets killed when this object is destroyed.
+ */
+class server
+{
+public:
+    server(
+              std::string const & binary
+            , std::string const & fixtures
+            , std::vector<std::string> const & options)
+    {
+        f_port = get_free_port();
+        if(f_port <= 0)
+        {
+            return;
+        }
+
+        std::vector<std::string> args{
+                  binary
+                , "--fixtures"
+                , fixtures
+                , "--port"
+                , std::to_string(f_port)
+            };
+        args.insert(args.end(), options.begin(), options.end());
+
+        f_pid = fork();
+        if(f_pid == 0)
+        {
+            std::vector<char *> argv;
+            for(auto & a : args)
+            {
+                argv.push_back(const_cast<char *>(a.c_str()));
+            }
+            argv.push_back(nullptr);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        for(int retry(0); retry < 50; ++retry)
+        {
+            if(can_connect(f_port))
+            {
+                f_running = true;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    server(server const &) = delete;
+    server & operator = (server const &) = delete;
+
+    ~server()
+    {
+        if(f_pid > 0)
+        {
+            kill(f_pid, SIGTERM);
+            waitpid(f_pid, nullptr, 0);
+        }
+    }
+
+    bool is_running() const
+    {
+        return f_running;
+    }
+
+    std::string url(std::string const & path) const
+    {
+        return "http://127.0.0.1:" + std::to_string(f_port) + path;
+    }
+
+private:
+    pid_t                   f_pid = -1;
+    int                     f_port = -1;
+    bool                    f_running = false;
+};
+
+
+/** \brief Download a getBuildRecords page and return its first state.
+ *
+ * \return The buildstate of the first snapdev record or an empty string.
+ */
+std::string get_build_state(
+      builder::http_client & client
+    , std::string const & url
+    , std::string const & filename
+    , builder::http_client::result_t & result)
+{
+    result = client.download(url, filename);
+    if(result == builder::http_client::result_t::RESULT_FAILED)
+    {
+        return std::string();
+    }
+
+    builder::build_record::vector_t records;
+    if(!builder::load_build_records(filename, records))
+    {
+        return std::string();
+    }
+    for(auto const & r : records)
+    {
+        if(r.f_source_package_name == g_project_name)
+        {
+            return r.f_buildstate;
+        }
+    }
+    return std::string();
+}
+
+
+void next_step(builder::http_client & client, server const & s, std::string const & tmp)
+{
+    client.download(s.url("/_fixture/next"), tmp + "/step");
+}
+
+
+void test_transitions(
+      std::string const & binary
+    , std::string const & fixtures
+    , std::string const & tmp)
+{
+    server s(binary, fixtures, {});
+    check(s.is_running(), "fixture server started");
+    if(!s.is_running())
+    {
+        return;
+    }
+
+    builder::http_client client(4);
+    client.start();
+
+    std::string const project_url(s.url(
+              std::string("/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=")
+            + g_project_name));
+    std::string const sweep_url(s.url("/ppa?ws.op=getBuildRecords&ws.size=50"));
+    std::string const deb_url(s.url(std::string("/+files/") + g_deb_name));
+    std::string const project_json(tmp + "/" + g_project_name + ".json");
+    std::string const sweep_json(tmp + "/sweep-0.json");
+    builder::http_client::result_t result;
+
+    // step 0 -- building
+    //
+    check(get_build_state(client, project_url, project_json, result) == "Currently building"
+        , "step 0: project is being built");
+    check(get_build_state(client, sweep_url, sweep_json, result) == "Currently building"
+        , "step 0: sweep shows the project being built");
+    check(client.head(deb_url) == 404, "step 0: .deb is not yet published");
+
+    result = client.download(project_url, project_json);
+    check(result == builder::http_client::result_t::RESULT_NOT_MODIFIED
+        , "step 0: second request is not modified");
+
+    // step 1 -- built
+    //
+    next_step(client, s, tmp);
+    check(get_build_state(client, project_url, project_json, result) == "Successfully built"
+        , "step 1: project was built");
+    check(result == builder::http_client::result_t::RESULT_DOWNLOADED
+        , "step 1: new records were downloaded");
+    check(get_build_state(client, sweep_url, sweep_json, result) == "Successfully built"
+        , "step 1: sweep shows the project as built");
+    check(client.head(deb_url) == 404, "step 1: .deb is not yet published");
+
+    // step 2 -- published
+    //
+    next_step(client, s, tmp);
+    check(get_build_state(client, project_url, project_json, result) == "Successfully built"
+        , "step 2: project is still built");
+    check(client.head(deb_url) == 200, "step 2: .deb is published");
+
+    client.stop();
+}
+
+
+void test_server_errors(
+      std::string const & binary
+    , std::string const & fixtures
+    , std::string const & tmp)
+{
+    server s(binary, fixtures, { "--error-rate", "100", "--error-status", "503" });
+    check(s.is_running(), "failing fixture server started");
+    if(!s.is_running())
+    {
+        return;
+    }
+
+    builder::remote_health::pointer_t health(std::make_shared<builder::remote_health>());
+    builder::http_client client(4);
+    client.set_remote_health(health);
+    client.start();
+
+    std::string const project_url(s.url(
+              std::string("/ppa?ws.op=getBuildRecords&ws.size=10&ws.start=0&source_name=")
+            + g_project_name));
+    std::string const project_json(tmp + "/" + g_project_name + "-503.json");
+
+    bool all_failed(true);
+    for(int i(0); i < 10 && health->get_state() == builder::remote_health::state_t::STATE_CLOSED; ++i)
+    {
+        if(client.download(project_url, project_json) != builder::http_client::result_t::RESULT_FAILED)
+        {
+            all_failed = false;
+        }
+    }
+    check(all_failed, "503: all the requests failed");
+    check(health->get_state() == builder::remote_health::state_t::STATE_OPEN
+        , "503: the circuit is open");
+    check(health->get_pause() > 0, "503: launchpad requests are paused");
+    check(client.download(project_url, project_json) == builder::http_client::result_t::RESULT_FAILED
+        , "503: new requests fail immediately");
+
+    client.stop();
+}
+
+
+} // no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    if(argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <fixture-server> <fixtures-dir>\n";
+        return 1;
+    }
+
+    char dir[] = "/tmp/snapbuilder-fixture-test-XXXXXX";
+    if(mkdtemp(dir) == nullptr)
+    {
+        std::cerr << "error: could not create a temporary directory.\n";
+        return 1;
+    }
+    std::string const tmp(dir);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    test_transitions(argv[1], argv[2], tmp);
+    test_server_errors(argv[1], argv[2], tmp);
+
+    curl_global_cleanup();
+
+    std::string const cmd("rm -rf '" + tmp + "'");
+    if(system(cmd.c_str()) != 0)
+    {
+        std::cerr << "warning: could not remove \"" << tmp << "\".\n";
+    }
+
+    if(g_errors != 0)
+    {
+        std::cerr << g_errors << " check(s) failed.\n";
+        return 1;
+    }
+    return 0;
+}
+
+// vim: ts=4 sw=4 et